@@ -1,4 +1,16 @@
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 namespace
@@ -11,17 +23,106 @@ namespace
                               'a','b','c','d','e','f','g','h','i',
                               'j','k','l','m','n','o','p','q','r',
                               's','t','u','v','w','x','y','z' };
-    int MARKER_NUMBER = 0;
+
+    // Number of triads sunk before the iterative search hands the remaining
+    // subproblems off to worker threads.
+    const int SUBPROBLEM_SPLIT_DEPTH = 10;
+
+    // Only search for tilings that are canonical under the left-right mirror.
+    const bool BREAK_MIRROR_SYMMETRY = true;
+
+    // Memory shared by all search threads' caches of frontiers that cannot be completed.
+    const size_t TRANSPOSITION_TABLE_BYTES = 32 << 20;
+
+    // Largest region the general lattice tiler accepts, one bit per dot.
+    const int MAX_REGION_DOTS = 1024;
+
+    // Enumerated tilings are buffered in memory and written out in chunks of this size.
+    const size_t TILING_WRITE_BUFFER_BYTES = 1 << 20;
+    const char TILING_FILE_MAGIC[4] = { 'T', 'R', 'I', 'D' };
 }
 
-bool isEntireBoardSunken(const std::vector<std::vector<char>>& pyramid)
+enum class TriadOrientation
 {
-    for (int i{}; i < pyramid.size(); ++i)
-        for (int j{}; j <= i; ++j)
-            if (pyramid[i][j] == DEFAULT_CHAR)
-                return false;
-    return true;
-}
+    Upward = 0,   // (row, col), (row + 1, col), (row + 1, col + 1)
+    Downward = 1, // (row, col), (row, col + 1), (row + 1, col + 1)
+};
+
+// One level of the explicit search stack. (row, col) is the first unsunken dot
+// when the frame was pushed, every triad this frame sinks has to cover it.
+struct TriadFrame
+{
+    int row;
+    int col;
+    int nextOrientation;        // 0 = try upward next, 1 = try downward next, 2 = exhausted
+    bool sunk;                  // The triad tried last (nextOrientation - 1) is still sunk
+    uint64_t frontierKey;       // Zobrist key of the sunken dots when the frame was pushed
+    long long unresolvedBefore; // Solutions and subproblems seen before the frame was pushed
+};
+
+struct CacheStatistics
+{
+    long long hits{};
+    long long misses{};
+    long long stores{};
+    long long replacements{};
+
+    void Add(const CacheStatistics& other)
+    {
+        hits += other.hits;
+        misses += other.misses;
+        stores += other.stores;
+        replacements += other.replacements;
+    }
+};
+
+/*
+ * Remembers frontiers from which the rest of the pyramid cannot be sunk.
+ *
+ * Each entry packs the top 52 bits of the key together with the number of
+ * dots that were left to cover (0 marks an empty slot) into a single word.
+ * Entries live in buckets of two. The first slot keeps whichever entry had
+ * more dots left, i.e. the bigger subtree, and the second slot is always
+ * replaced.
+ */
+struct TranspositionTable
+{
+    static const uint64_t REMAINING_DOTS_MASK = 0xFFF;
+
+    std::vector<uint64_t> entries_;
+    CacheStatistics stats_;
+
+    explicit TranspositionTable(size_t entryCount) : entries_(entryCount, 0) {};
+
+    bool Contains(uint64_t key)
+    {
+        const uint64_t* bucket = &entries_[BucketIndex(key)];
+        if (Matches(bucket[0], key) || Matches(bucket[1], key))
+        {
+            stats_.hits++;
+            return true;
+        }
+        stats_.misses++;
+        return false;
+    }
+
+    void Insert(uint64_t key, int remainingDots)
+    {
+        uint64_t* bucket = &entries_[BucketIndex(key)];
+        uint64_t entry = (key & ~REMAINING_DOTS_MASK) | std::min<uint64_t>(remainingDots, REMAINING_DOTS_MASK);
+        stats_.stores++;
+        uint64_t& slot = (entry & REMAINING_DOTS_MASK) >= (bucket[0] & REMAINING_DOTS_MASK) ? bucket[0] : bucket[1];
+        if (slot & REMAINING_DOTS_MASK) stats_.replacements++;
+        slot = entry;
+    }
+
+    static bool Matches(uint64_t entry, uint64_t key)
+    {
+        return (entry & REMAINING_DOTS_MASK) && (entry & ~REMAINING_DOTS_MASK) == (key & ~REMAINING_DOTS_MASK);
+    }
+
+    size_t BucketIndex(uint64_t key) const { return (key % (entries_.size() / 2)) * 2; }
+};
 
 void initializePyramid(std::vector<std::vector<char>>& pyramid)
 {
@@ -47,208 +148,818 @@ void printPyramid(const std::vector<std::vector<char>>& pyramid)
 }
 
 
-// row is the y-axis, col is the x-axis
-bool pyramidAboveAlreadySunken(const std::vector<std::vector<char>>& pyramid, int row, int col)
+void raiseUpwardTriad(std::vector<std::vector<char>>& pyramid, int row, int col)
 {
-    int k{}, i{};
-    for (; i <= row; ++i)
-    {
-        if (i < row)
-            k = i;
-        else
-            k = col;
+    pyramid[row][col] = DEFAULT_CHAR;
+    pyramid[row + 1][col] = DEFAULT_CHAR;
+    pyramid[row + 1][col + 1] = DEFAULT_CHAR;
+}
 
-        for (int j{}; j < col; ++j)
-        {
-            if (pyramid[i][j] == DEFAULT_CHAR)
-                return false;
-        }
-            
-    }
+void raiseDownwardTriad(std::vector<std::vector<char>>& pyramid, int row, int col)
+{
+    pyramid[row][col] = DEFAULT_CHAR;
+    pyramid[row][col + 1] = DEFAULT_CHAR;
+    pyramid[row + 1][col + 1] = DEFAULT_CHAR;
+}
 
-    return true;
+int DotsInTriangle(int height)
+{
+    return height * (height + 1) / 2;
 }
 
-void sinkUpwardTriads(std::vector<std::vector<char>>& pyramid, int row, int col)
+bool triadFits(const std::vector<std::vector<char>>& pyramid, int row, int col, TriadOrientation orientation)
 {
-    pyramid[row][col] = MARKERS[MARKER_NUMBER % MARKER_COUNT];
-    pyramid[row + 1][col] = MARKERS[MARKER_NUMBER % MARKER_COUNT];
-    pyramid[row + 1][col + 1] = MARKERS[MARKER_NUMBER % MARKER_COUNT];
-    MARKER_NUMBER++;
+    if (row + 1 >= static_cast<int>(pyramid.size()) || pyramid[row][col] != DEFAULT_CHAR || pyramid[row + 1][col + 1] != DEFAULT_CHAR)
+        return false;
+    if (orientation == TriadOrientation::Upward)
+        return pyramid[row + 1][col] == DEFAULT_CHAR;
+    return col < row && pyramid[row][col + 1] == DEFAULT_CHAR;
 }
 
-void sinkDownwardTriads(std::vector<std::vector<char>>& pyramid, int row, int col)
+void sinkTriad(std::vector<std::vector<char>>& pyramid, int row, int col, TriadOrientation orientation, char marker)
 {
-    pyramid[row][col] = MARKERS[MARKER_NUMBER % MARKER_COUNT];
-    pyramid[row][col + 1] = MARKERS[MARKER_NUMBER % MARKER_COUNT];
-    pyramid[row + 1][col + 1] = MARKERS[MARKER_NUMBER % MARKER_COUNT];
-    MARKER_NUMBER++;
+    pyramid[row][col] = marker;
+    pyramid[row + 1][col + 1] = marker;
+    if (orientation == TriadOrientation::Upward)
+        pyramid[row + 1][col] = marker;
+    else
+        pyramid[row][col + 1] = marker;
 }
 
-bool canMoveRight(int row, int col, int size)
+void raiseTriad(std::vector<std::vector<char>>& pyramid, int row, int col, TriadOrientation orientation)
 {
-    if (col + 1 < size && row + 1 < size && col < row)
-        return true;
-    return false;
+    if (orientation == TriadOrientation::Upward)
+        raiseUpwardTriad(pyramid, row, col);
+    else
+        raiseDownwardTriad(pyramid, row, col);
 }
 
-bool canMoveDown(int row, int col, int size)
+// Scans forward (row by row, left to right) from (row, col) for the first dot
+// that is not covered yet. Returns false once the whole pyramid is sunken.
+bool findFirstUnsunkenDot(const std::vector<std::vector<char>>& pyramid, int& row, int& col)
 {
-    if (row + 2 < size) return true;
+    for (; row < static_cast<int>(pyramid.size()); ++row, col = 0)
+        for (; col <= row; ++col)
+            if (pyramid[row][col] == DEFAULT_CHAR)
+                return true;
     return false;
 }
 
-void raiseUpwardTriad(std::vector<std::vector<char>>& pyramid, int row, int col)
+/*
+ * Zobrist key of a single dot, computed with splitmix64 so threads never have
+ * to share a table of random numbers.
+ */
+uint64_t zobristKey(int row, int col)
 {
-    pyramid[row][col] = DEFAULT_CHAR;
-    pyramid[row + 1][col] = DEFAULT_CHAR;
-    pyramid[row + 1][col + 1] = DEFAULT_CHAR;
+    uint64_t z = (static_cast<uint64_t>(row) << 32 | static_cast<uint32_t>(col)) + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
 }
 
-void raiseDownwardTriad(std::vector<std::vector<char>>& pyramid, int row, int col)
+uint64_t triadKey(int row, int col, TriadOrientation orientation)
 {
-    pyramid[row][col] = DEFAULT_CHAR;
-    pyramid[row][col + 1] = DEFAULT_CHAR;
-    pyramid[row + 1][col + 1] = DEFAULT_CHAR;
+    uint64_t key = zobristKey(row, col) ^ zobristKey(row + 1, col + 1);
+    if (orientation == TriadOrientation::Upward)
+        return key ^ zobristKey(row + 1, col);
+    return key ^ zobristKey(row, col + 1);
 }
 
-bool sinkTriads(std::vector<std::vector<char>>& pyramid, int row, int col, int& iterationCount, bool& solutionFound)
+/*
+ * Mirroring the pyramid left to right maps an upward triad at (row, col) onto
+ * an upward triad at (row, row - col), and a downward triad at (row, col) onto
+ * a downward triad at (row, row - col - 1).
+ *
+ * The top triad is always upward, so the first real choice is how to cover
+ * dot (2, 0). We call a tiling canonical if that choice is no greater
+ * (upward < downward) than the one its mirror image makes, i.e. than the
+ * triad covering dot (2, 2). If (2, 0) is covered downward, that triad also
+ * takes (2, 1), so (2, 2) has to be covered by an upward triad and the mirror
+ * image covers (2, 0) upward. Every tileable pyramid therefore has a canonical
+ * tiling that covers (2, 0) with an upward triad, and the downward branch there
+ * never needs to be searched.
+ */
+bool isMirrorCanonical(int row, int col, TriadOrientation orientation)
 {
-    if (DEBUG_MODE) std::cout << "X Coordinate: " << row << " Y Coordinate: " << col << std::endl;
-    if (solutionFound) return true;
-    if (!pyramidAboveAlreadySunken(pyramid, row, col))
-        return true;
-    if (!(row >= 0 && col >= 0 && col <= row))
+    return !(row == 2 && col == 0 && orientation == TriadOrientation::Downward);
+}
+
+/*
+ * Depth-first search for a tiling. The first unsunken dot can only be the
+ * top-left dot of an upward or a downward triad, so each frame on the stack
+ * has exactly two choices, and the sequence of chosen orientations describes
+ * a (partial) tiling completely.
+ *
+ * prefix is a sequence of orientations that is replayed before searching and
+ * never backtracked over. If subproblems is not null, the search stops
+ * descending once splitDepth triads are sunk and records the orientations
+ * that led there instead, so the subtrees can be searched by other threads.
+ *
+ * If breakMirrorSymmetry is set, only mirror-canonical tilings are searched.
+ *
+ * If cache is set, frontiers that turn out to be dead ends are stored in it and
+ * skipped when they come up again. Every dot before the first unsunken one is
+ * covered and no triad reaches below the row after it, so the Zobrist key of
+ * the sunken dots identifies the remaining subproblem (up to 64-bit collisions).
+ *
+ * If onSolution is set it is called with the orientations of every complete
+ * tiling. Returning true from it keeps the search going, which enumerates
+ * all tilings.
+ *
+ * Returns true if the pyramid was completely sunken, in which case it is left
+ * in its solved state. Otherwise the pyramid is restored to how it was passed
+ * in, unless the search was cancelled through solutionFound.
+ */
+bool iterativeSinkTriads(std::vector<std::vector<char>>& pyramid, const std::vector<TriadOrientation>& prefix,
+    int splitDepth, std::vector<std::vector<TriadOrientation>>* subproblems, bool breakMirrorSymmetry,
+    TranspositionTable* cache, const std::atomic<bool>& solutionFound, long long& iterationCount,
+    const std::function<bool(const std::vector<TriadOrientation>&)>& onSolution = nullptr)
+{
+    // Sunk prefix triads, so they can be raised again if this subproblem fails.
+    std::vector<TriadFrame> prefixFrames;
+    auto raisePrefix = [&]()
+    {
+        for (const TriadFrame& frame : prefixFrames)
+            raiseTriad(pyramid, frame.row, frame.col, static_cast<TriadOrientation>(frame.nextOrientation - 1));
+    };
+
+    int row{}, col{};
+    uint64_t frontierKey{};
+    for (size_t depth{}; depth < prefix.size(); ++depth)
+    {
+        if (!findFirstUnsunkenDot(pyramid, row, col) || !triadFits(pyramid, row, col, prefix[depth]))
+        {
+            raisePrefix();
+            return false;
+        }
+        sinkTriad(pyramid, row, col, prefix[depth], MARKERS[depth % MARKER_COUNT]);
+        prefixFrames.push_back({ row, col, static_cast<int>(prefix[depth]) + 1, true, frontierKey, 0 });
+        frontierKey ^= triadKey(row, col, prefix[depth]);
+    }
+
+    if (!findFirstUnsunkenDot(pyramid, row, col))
+    {
+        if (!onSolution || !onSolution(prefix))
+            return true;
+        raisePrefix();
         return false;
-    //if (iterationCount != 0 && iterationCount % 30000 == 0)
-    //{
-    //    std::cout << "Iterations passsed: " << iterationCount << std::endl;
-    //    printPyramid(pyramid);
-    //}
-        
+    }
 
-    bool downTriad{}, upTriad{}, movedRight{}, needToRaiseTriad{};
-    iterationCount++;
+    if (cache && cache->Contains(frontierKey))
+    {
+        raisePrefix();
+        return false;
+    }
 
-    // Try an upward triangle
-    if (pyramid[row][col] == DEFAULT_CHAR && pyramid[row + 1][col] == DEFAULT_CHAR && pyramid[row + 1][col + 1] == DEFAULT_CHAR)
+    const int totalDots = DotsInTriangle(pyramid.size());
+    long long unresolvedLeaves{};
+    std::vector<TriadOrientation> path(prefix);
+    std::vector<TriadFrame> stack;
+    stack.push_back({ row, col, 0, false, frontierKey, unresolvedLeaves });
+    while (!stack.empty())
     {
-        sinkUpwardTriads(pyramid, row, col);
+        if (solutionFound) break;
+
+        TriadFrame& frame = stack.back();
+        if (frame.sunk)
+        {
+            raiseTriad(pyramid, frame.row, frame.col, static_cast<TriadOrientation>(frame.nextOrientation - 1));
+            frame.sunk = false;
+            path.pop_back();
+        }
+
+        if (frame.nextOrientation > 1)
+        {
+            // Only a subtree that was searched completely and held no tiling is a dead end.
+            if (cache && frame.unresolvedBefore == unresolvedLeaves)
+                cache->Insert(frame.frontierKey, totalDots - 3 * static_cast<int>(path.size()));
+            stack.pop_back();
+            continue;
+        }
 
-        upTriad = true;
+        TriadOrientation orientation = static_cast<TriadOrientation>(frame.nextOrientation++);
+        if (!triadFits(pyramid, frame.row, frame.col, orientation))
+            continue;
+        if (breakMirrorSymmetry && !isMirrorCanonical(frame.row, frame.col, orientation))
+            continue;
+
+        ++iterationCount;
+        sinkTriad(pyramid, frame.row, frame.col, orientation, MARKERS[path.size() % MARKER_COUNT]);
+        frame.sunk = true;
+        path.push_back(orientation);
 
-        if (DEBUG_MODE) std::cout << "Upward Triad\n";
         if (DEBUG_MODE) printPyramid(pyramid);
 
-        if (canMoveRight(row, col, pyramid.size()))
+        int nextRow{ frame.row }, nextCol{ frame.col };
+        if (!findFirstUnsunkenDot(pyramid, nextRow, nextCol))
+        {
+            if (onSolution && onSolution(path))
+            {
+                ++unresolvedLeaves;
+                continue;
+            }
+            return true;
+        }
+
+        if (subproblems && path.size() == static_cast<size_t>(splitDepth))
         {
-            movedRight = true;
-            needToRaiseTriad = sinkTriads(pyramid, row, col + 1, iterationCount, solutionFound);
-            if (needToRaiseTriad)
-                raiseUpwardTriad(pyramid, row, col);
+            subproblems->push_back(path);
+            ++unresolvedLeaves;
+            continue;
         }
+
+        uint64_t nextKey = frame.frontierKey ^ triadKey(frame.row, frame.col, orientation);
+        if (cache && cache->Contains(nextKey))
+            continue;
+
+        stack.push_back({ nextRow, nextCol, 0, false, nextKey, unresolvedLeaves });
+    }
+
+    if (solutionFound) return false;
+    raisePrefix();
+    return false;
+}
+
+/*
+ * Entries for one of threadCount caches searching a pyramid of the given
+ * height. A frontier is the first unsunken dot plus which of the height dots
+ * after it are already covered, so there are at most DotsInTriangle(height) *
+ * 2^height of them; twice that, rounded up to a power of two, keeps small
+ * pyramids from allocating more than they could ever fill.
+ */
+size_t transpositionTableEntries(int height, int threadCount)
+{
+    const size_t budget = TRANSPOSITION_TABLE_BYTES / sizeof(uint64_t) / std::max(1, threadCount);
+    const double frontiers = static_cast<double>(DotsInTriangle(height)) * std::ldexp(1., height);
+    size_t entries = 2;
+    while (entries < budget && entries < 2 * frontiers)
+        entries *= 2;
+    return std::min(entries, std::max<size_t>(budget, 2));
+}
+
+void printCacheStatistics(const CacheStatistics& stats)
+{
+    long long lookups = stats.hits + stats.misses;
+    std::cout << "Cache hits: " << stats.hits << " misses: " << stats.misses << " hit rate: "
+        << (lookups ? 100. * stats.hits / lookups : 0.) << "% stores: " << stats.stores
+        << " replacements: " << stats.replacements << std::endl;
+}
+
+/*
+ * Searches the whole pyramid, splitting the search tree at SUBPROBLEM_SPLIT_DEPTH
+ * and handing the subproblems out to one worker per core. The first worker to
+ * sink the whole pyramid raises solutionFound, which every other worker checks
+ * on each step and stops. Each worker keeps its own cache of dead frontiers
+ * across all the subproblems it takes on.
+ */
+bool solvePyramid(std::vector<std::vector<char>>& pyramid, long long& iterationCount, CacheStatistics& cacheStatistics)
+{
+    std::atomic<bool> solutionFound{ false };
+    const int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    const int height = static_cast<int>(pyramid.size());
+    if (threadCount == 1)
+    {
+        TranspositionTable cache(transpositionTableEntries(height, 1));
+        bool solved = iterativeSinkTriads(pyramid, {}, 0, nullptr, BREAK_MIRROR_SYMMETRY, &cache, solutionFound,
+            iterationCount);
+        cacheStatistics.Add(cache.stats_);
+        return solved;
     }
 
-    // Try the triangle above
-    if (pyramid[row][col] == DEFAULT_CHAR && pyramid[row][col + 1] == DEFAULT_CHAR && pyramid[row + 1][col + 1] == DEFAULT_CHAR)
+    std::vector<std::vector<TriadOrientation>> subproblems;
+    if (iterativeSinkTriads(pyramid, {}, SUBPROBLEM_SPLIT_DEPTH, &subproblems, BREAK_MIRROR_SYMMETRY, nullptr,
+        solutionFound, iterationCount))
+        return true;
+    if (subproblems.empty())
+        return false;
+
+    // Every worker gets its share of the memory budget, allocated once it takes on a subproblem.
+    const int workerCount = static_cast<int>(std::min<size_t>(threadCount, subproblems.size()));
+    const size_t cacheEntries = transpositionTableEntries(height, workerCount);
+    const std::vector<std::vector<char>> initialPyramid(pyramid);
+    std::atomic<size_t> nextSubproblem{ 0 };
+    std::mutex solutionMutex;
+    std::vector<long long> workerIterations(workerCount, 0);
+    std::vector<CacheStatistics> workerCacheStatistics(workerCount);
+    std::vector<std::thread> workers;
+    for (int t{}; t < workerCount; ++t)
     {
+        workers.emplace_back([&, t]()
+        {
+            std::unique_ptr<TranspositionTable> cache;
+            for (size_t i = nextSubproblem++; i < subproblems.size() && !solutionFound; i = nextSubproblem++)
+            {
+                if (!cache)
+                    cache = std::make_unique<TranspositionTable>(cacheEntries);
+                std::vector<std::vector<char>> workerPyramid(initialPyramid);
+                if (iterativeSinkTriads(workerPyramid, subproblems[i], 0, nullptr, BREAK_MIRROR_SYMMETRY, cache.get(),
+                    solutionFound, workerIterations[t]))
+                {
+                    std::lock_guard<std::mutex> lock(solutionMutex);
+                    if (!solutionFound)
+                    {
+                        pyramid = workerPyramid;
+                        solutionFound = true;
+                    }
+                }
+            }
+            if (cache)
+                workerCacheStatistics[t] = cache->stats_;
+        });
+    }
 
-        sinkDownwardTriads(pyramid, row, col);
+    for (std::thread& worker : workers)
+        worker.join();
+    for (int t{}; t < workerCount; ++t)
+    {
+        iterationCount += workerIterations[t];
+        cacheStatistics.Add(workerCacheStatistics[t]);
+    }
+    return solutionFound;
+}
 
-        downTriad = true;
+/*
+1
+1 1
+1 1 1
+1 X 0 0
+1 x x 0 0
 
-        if (DEBUG_MODE) std::cout << "Downward Triad\n";
-        if (DEBUG_MODE) printPyramid(pyramid);
 
-        if (canMoveRight(row, col + 1, pyramid[0].size()))
+*/
+
+/*
+ * Colour dot (row, col) with (row + col) % 3. The three dots of any triad,
+ * upward or downward, get three different colours, so a region tileable by
+ * triads needs exactly as many dots of each colour.
+ */
+bool colorClassesBalanced(const std::vector<std::pair<int, int>>& dots)
+{
+    int colorCounts[3]{};
+    for (const auto& dot : dots)
+        colorCounts[(dot.first + dot.second) % 3]++;
+    return colorCounts[0] == colorCounts[1] && colorCounts[1] == colorCounts[2];
+}
+
+// For the pyramid this subsumes DotsInTriangle(height) % 3.
+bool colorClassesBalanced(int height)
+{
+    std::vector<std::pair<int, int>> dots;
+    for (int row{}; row < height; ++row)
+        for (int col{}; col <= row; ++col)
+            dots.emplace_back(row, col);
+    return colorClassesBalanced(dots);
+}
+
+/*
+ * Compact tiling files.
+ *
+ * Triads are always sunk on the first unsunken dot, so a tiling is fully
+ * described by the orientation of each triad in the order they were sunk:
+ * one bit per triad, 0 = upward and 1 = downward. Each tiling is packed
+ * least significant bit first and padded to whole bytes, so tiling i sits at
+ * a fixed offset. The file starts with TILING_FILE_MAGIC and the height as a
+ * 32-bit little-endian integer.
+ */
+
+// In 64 bits, so a corrupt header height cannot overflow it.
+long long bytesPerTiling(int height)
+{
+    return (static_cast<long long>(height) * (height + 1) / 2 / 3 + 7) / 8;
+}
+
+struct TilingWriter
+{
+    std::ofstream output_;
+    std::vector<unsigned char> buffer_;
+    long long tilingCount_;
+    long long tilingBytes_;
+
+    TilingWriter(const std::string& path, int height) :
+        output_(path, std::ios::binary), tilingCount_(0), tilingBytes_(bytesPerTiling(height))
+    {
+        buffer_.reserve(TILING_WRITE_BUFFER_BYTES);
+        buffer_.insert(buffer_.end(), TILING_FILE_MAGIC, TILING_FILE_MAGIC + 4);
+        for (int shift{}; shift < 32; shift += 8)
+            buffer_.push_back(static_cast<unsigned char>(static_cast<uint32_t>(height) >> shift));
+    }
+
+    ~TilingWriter() { Flush(); }
+
+    bool IsOpen() const { return output_.is_open(); }
+
+    void Write(const std::vector<TriadOrientation>& orientations)
+    {
+        if (buffer_.size() + tilingBytes_ > TILING_WRITE_BUFFER_BYTES)
+            Flush();
+        size_t start = buffer_.size();
+        buffer_.resize(start + tilingBytes_, 0);
+        for (size_t i{}; i < orientations.size(); ++i)
+            if (orientations[i] == TriadOrientation::Downward)
+                buffer_[start + i / 8] |= 1 << (i % 8);
+        ++tilingCount_;
+    }
+
+    void Flush()
+    {
+        output_.write(reinterpret_cast<const char*>(buffer_.data()), buffer_.size());
+        buffer_.clear();
+    }
+};
+
+/*
+ * Writes every tiling of the pyramid of the given height to path. Mirror
+ * symmetry is not broken here, both images of a tiling are written.
+ */
+int enumeratePyramidTilings(int height, const std::string& path)
+{
+    TilingWriter writer(path, height);
+    if (!writer.IsOpen())
+    {
+        std::cout << "Could not open " << path << std::endl;
+        return 1;
+    }
+
+    std::atomic<bool> solutionFound{ false };
+    long long iterationCount{};
+    std::vector<std::vector<char>> pyramid(height, std::vector<char>(height, DEFAULT_CHAR));
+    initializePyramid(pyramid);
+    TranspositionTable cache(transpositionTableEntries(height, 1));
+    if (colorClassesBalanced(height))
+    {
+        iterativeSinkTriads(pyramid, {}, 0, nullptr, false, &cache, solutionFound, iterationCount,
+            [&](const std::vector<TriadOrientation>& orientations)
+            {
+                writer.Write(orientations);
+                return true;
+            });
+    }
+
+    std::cout << "Pyramid with N = " << height << " has " << writer.tilingCount_ << " tilings\n";
+    std::cout << "Number of iterations: " << iterationCount << std::endl;
+    printCacheStatistics(cache.stats_);
+    return 0;
+}
+
+// Reads tiling number index back from a file written by enumeratePyramidTilings and prints it.
+int decodePyramidTiling(const std::string& path, long long index)
+{
+    std::ifstream input(path, std::ios::binary);
+    unsigned char header[8]{};
+    if (!input.read(reinterpret_cast<char*>(header), sizeof(header)) || !std::equal(header, header + 4, TILING_FILE_MAGIC))
+    {
+        std::cout << path << " is not a tiling file" << std::endl;
+        return 1;
+    }
+    int height = header[4] | header[5] << 8 | header[6] << 16 | header[7] << 24;
+
+    // Check the height against the file size before allocating anything for it.
+    input.seekg(0, std::ios::end);
+    long long tilingBytes = bytesPerTiling(height);
+    long long tilingCount = height > 0 ? (static_cast<long long>(input.tellg()) - static_cast<long long>(sizeof(header))) / tilingBytes : 0;
+    if (tilingCount < 1)
+    {
+        std::cout << path << " holds no tilings of height " << height << std::endl;
+        return 1;
+    }
+    if (index < 0 || index >= tilingCount)
+    {
+        std::cout << "Tiling " << index << " is not in " << path << std::endl;
+        return 1;
+    }
+
+    std::vector<unsigned char> tiling(tilingBytes);
+    input.seekg(sizeof(header) + index * tilingBytes);
+    if (!input.read(reinterpret_cast<char*>(tiling.data()), tiling.size()))
+    {
+        std::cout << "Tiling " << index << " is not in " << path << std::endl;
+        return 1;
+    }
+
+    std::vector<std::vector<char>> pyramid(height, std::vector<char>(height, DEFAULT_CHAR));
+    initializePyramid(pyramid);
+    int row{}, col{};
+    for (int i{}; i < DotsInTriangle(height) / 3; ++i)
+    {
+        TriadOrientation orientation = static_cast<TriadOrientation>((tiling[i / 8] >> (i % 8)) & 1);
+        if (!findFirstUnsunkenDot(pyramid, row, col) || !triadFits(pyramid, row, col, orientation))
         {
-            movedRight = true;
-            needToRaiseTriad = sinkTriads(pyramid, row, col + 2, iterationCount, solutionFound);
-            if (needToRaiseTriad)
-                raiseDownwardTriad(pyramid, row, col);
+            std::cout << "Tiling " << index << " in " << path << " is corrupt" << std::endl;
+            return 1;
         }
+        sinkTriad(pyramid, row, col, orientation, MARKERS[i % MARKER_COUNT]);
     }
+    printPyramid(pyramid);
+    return 0;
+}
+
+/*
+ * General triangular-lattice tiler.
+ *
+ * Regions and pieces are described the same way the pyramid is stored: one
+ * line of text per row, where the character in column col is DEFAULT_CHAR
+ * ('!') if dot (row, col) belongs to the shape and anything else if it does
+ * not. Dot (row, col) neighbours (row, col +- 1), (row +- 1, col) and
+ * (row +- 1, col +- 1), so the pyramid of height 3 and a hexagon of side 2 are
+ *
+ *     !          !!0
+ *     !!         !!!
+ *     !!!        0!!
+ *
+ * Every piece is used in all of its rotations and reflections, in any number.
+ */
+
+using LatticeDot = std::pair<int, int>; // (row, col)
+using RegionMask = std::bitset<MAX_REGION_DOTS>;
+
+struct LatticeRegion
+{
+    std::vector<LatticeDot> dots;            // In row-major order
+    std::vector<std::vector<int>> dotIndex;  // [row][col] -> index into dots, -1 if outside
+};
+
+struct PiecePlacement
+{
+    int piece;
+    RegionMask mask;
+    std::vector<int> dots;
+};
 
-    if (isEntireBoardSunken(pyramid))
+std::vector<std::string> readShapeRows(std::istream& input)
+{
+    std::vector<std::string> rows;
+    std::string line;
+    while (std::getline(input, line))
     {
-        std::cout << "\r\n* Hooray! Pyramid with N = " << pyramid.size() << " is complete\n";
-        std::cout << "Number of iterations: " << iterationCount << std::endl;
-        printPyramid(pyramid);
-        solutionFound = true;
-        return true;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        rows.push_back(line);
     }
+    return rows;
+}
 
-    if (!downTriad && !upTriad && canMoveRight(row, col, pyramid.size()))
+std::vector<LatticeDot> parseShapeDots(const std::vector<std::string>& rows)
+{
+    std::vector<LatticeDot> dots;
+    for (int row{}; row < static_cast<int>(rows.size()); ++row)
+        for (int col{}; col < static_cast<int>(rows[row].size()); ++col)
+            if (rows[row][col] == DEFAULT_CHAR)
+                dots.emplace_back(row, col);
+    return dots;
+}
+
+LatticeRegion parseRegion(const std::vector<std::string>& rows)
+{
+    LatticeRegion region;
+    region.dots = parseShapeDots(rows);
+    for (const std::string& row : rows)
+        region.dotIndex.emplace_back(row.size(), -1);
+    for (int i{}; i < static_cast<int>(region.dots.size()); ++i)
+        region.dotIndex[region.dots[i].first][region.dots[i].second] = i;
+    return region;
+}
+
+// Sorts the dots and translates them so the first one sits on (0, 0).
+std::vector<LatticeDot> normalizeShape(std::vector<LatticeDot> dots)
+{
+    std::sort(dots.begin(), dots.end());
+    const LatticeDot origin = dots.front();
+    for (LatticeDot& dot : dots)
+        dot = { dot.first - origin.first, dot.second - origin.second };
+    return dots;
+}
+
+/*
+ * All distinct rotations and reflections of a piece. Rotating by 60 degrees
+ * maps (row, col) onto (col, col - row), and the pyramid's left-right mirror
+ * maps it onto (row, row - col).
+ */
+std::vector<std::vector<LatticeDot>> pieceImages(const std::vector<LatticeDot>& shape)
+{
+    std::vector<std::vector<LatticeDot>> images;
+    std::vector<LatticeDot> image(shape);
+    for (int reflection{}; reflection < 2; ++reflection)
     {
-        if (pyramid[row][col] != DEFAULT_CHAR)
+        for (int rotation{}; rotation < 6; ++rotation)
         {
-            needToRaiseTriad = sinkTriads(pyramid, row, col + 1, iterationCount, solutionFound);
-            if (row == 1 && col == 0) return false;
+            std::vector<LatticeDot> normalized = normalizeShape(image);
+            if (std::find(images.begin(), images.end(), normalized) == images.end())
+                images.push_back(normalized);
+            for (LatticeDot& dot : image)
+                dot = { dot.second, dot.second - dot.first };
         }
-        return true;
+        for (LatticeDot& dot : image)
+            dot = { dot.first, dot.first - dot.second };
     }
+    return images;
+}
 
-    if (canMoveDown(row, col, pyramid.size()))
+/*
+ * Every way of putting a piece image into the region, grouped by the first dot
+ * (in row-major order) the placement covers. Since images are normalized, that
+ * is the dot the image's (0, 0) lands on.
+ */
+std::vector<std::vector<PiecePlacement>> createPlacements(const LatticeRegion& region,
+    const std::vector<std::vector<LatticeDot>>& pieces)
+{
+    std::vector<std::vector<PiecePlacement>> placementsByDot(region.dots.size());
+    for (int piece{}; piece < static_cast<int>(pieces.size()); ++piece)
     {
-        needToRaiseTriad = sinkTriads(pyramid, row + 1, 0, iterationCount, solutionFound);
+        for (const std::vector<LatticeDot>& image : pieceImages(pieces[piece]))
+        {
+            for (size_t anchor{}; anchor < region.dots.size(); ++anchor)
+            {
+                PiecePlacement placement{ piece, {}, {} };
+                for (const LatticeDot& offset : image)
+                {
+                    int row = region.dots[anchor].first + offset.first;
+                    int col = region.dots[anchor].second + offset.second;
+                    if (row < 0 || row >= static_cast<int>(region.dotIndex.size()) || col < 0 ||
+                        col >= static_cast<int>(region.dotIndex[row].size()) ||
+                        region.dotIndex[row][col] < 0)
+                        break;
+                    placement.dots.push_back(region.dotIndex[row][col]);
+                    placement.mask.set(region.dotIndex[row][col]);
+                }
+                if (placement.dots.size() == image.size())
+                    placementsByDot[anchor].push_back(placement);
+            }
+        }
+    }
+    return placementsByDot;
+}
 
-        if (upTriad)
+/*
+ * Same explicit-stack search as iterativeSinkTriads, on bitmasks: cover the
+ * first empty dot with each placement anchored there in turn. On success
+ * chosenPlacements holds (anchor, index into placementsByDot[anchor]) pairs.
+ */
+bool tileRegion(const LatticeRegion& region, const std::vector<std::vector<PiecePlacement>>& placementsByDot,
+    std::vector<std::pair<int, int>>& chosenPlacements, long long& iterationCount)
+{
+    struct RegionFrame
+    {
+        int anchor;
+        int nextPlacement;
+    };
+
+    const int dotCount = static_cast<int>(region.dots.size());
+    auto firstEmptyDot = [&](const RegionMask& covered, int from)
+    {
+        while (from < dotCount && covered.test(from))
+            ++from;
+        return from;
+    };
+
+    RegionMask covered;
+    chosenPlacements.clear();
+    std::vector<RegionFrame> stack;
+    if (region.dots.empty())
+        return true;
+    stack.push_back({ 0, 0 });
+    while (!stack.empty())
+    {
+        RegionFrame& frame = stack.back();
+        if (chosenPlacements.size() == stack.size())
         {
-            raiseUpwardTriad(pyramid, row, col);
+            covered ^= placementsByDot[frame.anchor][chosenPlacements.back().second].mask;
+            chosenPlacements.pop_back();
         }
 
-        if (downTriad)
+        const std::vector<PiecePlacement>& candidates = placementsByDot[frame.anchor];
+        const int candidateCount = static_cast<int>(candidates.size());
+        while (frame.nextPlacement < candidateCount && (covered & candidates[frame.nextPlacement].mask).any())
+            ++frame.nextPlacement;
+        if (frame.nextPlacement == candidateCount)
         {
-            raiseDownwardTriad(pyramid, row, col);
+            stack.pop_back();
+            continue;
         }
 
-        return true;
-    }
+        ++iterationCount;
+        covered |= candidates[frame.nextPlacement].mask;
+        chosenPlacements.emplace_back(frame.anchor, frame.nextPlacement++);
 
-    if (upTriad)
-    {
-        raiseUpwardTriad(pyramid, row, col);
+        int nextAnchor = firstEmptyDot(covered, frame.anchor);
+        if (nextAnchor == dotCount)
+            return true;
+        stack.push_back({ nextAnchor, 0 });
     }
+    return false;
+}
 
-    if (downTriad)
+// Prints a tiling in the same style as printPyramid, one marker per placed piece.
+void printRegionTiling(const LatticeRegion& region, const std::vector<std::vector<PiecePlacement>>& placementsByDot,
+    const std::vector<std::pair<int, int>>& chosenPlacements)
+{
+    std::vector<std::vector<char>> rows;
+    for (const std::vector<int>& row : region.dotIndex)
+        rows.emplace_back(row.size(), ' ');
+    for (const LatticeDot& dot : region.dots)
+        rows[dot.first][dot.second] = DEFAULT_CHAR;
+    for (size_t i{}; i < chosenPlacements.size(); ++i)
+        for (int dot : placementsByDot[chosenPlacements[i].first][chosenPlacements[i].second].dots)
+            rows[region.dots[dot].first][region.dots[dot].second] = MARKERS[i % MARKER_COUNT];
+
+    for (size_t i{}; i < rows.size(); ++i)
     {
-        raiseDownwardTriad(pyramid, row, col);
+        for (size_t j{}; j < rows.size() - i; ++j) std::cout << ' ';
+        for (char dot : rows[i]) std::cout << dot << ' ';
+        std::cout << std::endl;
     }
-
-    return true;
+    std::cout << std::endl;
 }
 
 /*
-1
-1 1
-1 1 1
-1 X 0 0
-1 x x 0 0
+ * Tiles the region in regionPath with the pieces in piecePaths, or with triads
+ * if no pieces are given.
+ */
+int tileRegionFromFiles(const std::string& regionPath, const std::vector<std::string>& piecePaths)
+{
+    std::ifstream regionFile(regionPath);
+    if (!regionFile)
+    {
+        std::cout << "Could not open region " << regionPath << std::endl;
+        return 1;
+    }
+    LatticeRegion region = parseRegion(readShapeRows(regionFile));
+    if (region.dots.size() > MAX_REGION_DOTS)
+    {
+        std::cout << "Region has " << region.dots.size() << " dots, at most " << MAX_REGION_DOTS << " are supported" << std::endl;
+        return 1;
+    }
 
+    std::vector<std::vector<LatticeDot>> pieces;
+    for (const std::string& piecePath : piecePaths)
+    {
+        std::ifstream pieceFile(piecePath);
+        std::vector<LatticeDot> shape = parseShapeDots(readShapeRows(pieceFile));
+        if (shape.empty())
+        {
+            std::cout << "Could not read piece " << piecePath << std::endl;
+            return 1;
+        }
+        pieces.push_back(shape);
+    }
+    if (pieces.empty())
+        pieces.push_back({ { 0, 0 }, { 1, 0 }, { 1, 1 } });
 
-*/
+    // The colouring argument holds as long as every piece covers each colour equally.
+    bool allPiecesBalanced = std::all_of(pieces.begin(), pieces.end(),
+        [](const std::vector<LatticeDot>& piece) { return colorClassesBalanced(piece); });
+    if (allPiecesBalanced && !colorClassesBalanced(region.dots))
+    {
+        std::cout << "Region colour classes are unequal, it cannot be tiled" << std::endl;
+        return 0;
+    }
 
-int DotsInTriangle(int height)
-{
-    return height * (height + 1) / 2;
+    long long iterationCount{};
+    std::vector<std::pair<int, int>> chosenPlacements;
+    std::vector<std::vector<PiecePlacement>> placementsByDot = createPlacements(region, pieces);
+    if (tileRegion(region, placementsByDot, chosenPlacements, iterationCount))
+    {
+        std::cout << "* Hooray! Region with " << region.dots.size() << " dots is complete\n";
+        std::cout << "Number of iterations: " << iterationCount << std::endl;
+        printRegionTiling(region, placementsByDot, chosenPlacements);
+    }
+    else
+    {
+        std::cout << "Region cannot be tiled. Number of iterations: " << iterationCount << std::endl;
+    }
+    return 0;
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+    // solution --region <region file> [piece files...]
+    if (argc >= 3 && std::string(argv[1]) == "--region")
+        return tileRegionFromFiles(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    // solution --enumerate <height> <output file>
+    if (argc == 4 && std::string(argv[1]) == "--enumerate")
+        return enumeratePyramidTilings(std::stoi(argv[2]), argv[3]);
+    // solution --decode <tiling file> <index>
+    if (argc == 4 && std::string(argv[1]) == "--decode")
+        return decodePyramidTiling(argv[2], std::stoll(argv[3]));
+
     int answer{};
     for (int i{2}; i < 15; ++i)
     {
-        MARKER_NUMBER = 0;
-        if (DotsInTriangle(i) % 3 != 0) continue;
+        if (!colorClassesBalanced(i)) continue;
         std::cout << "########## ANALYSING DEPTH " << i << " ##########" << std::endl;
-        bool containsAnswer{};
-        int iterationCount{};
+        long long iterationCount{};
+        CacheStatistics cacheStatistics;
         std::vector<std::vector<char>> pyramid(i, std::vector<char>(i, DEFAULT_CHAR));
         initializePyramid(pyramid);
         //printPyramid(pyramid);
-        sinkTriads(pyramid, 0, 0, iterationCount, containsAnswer);
+        bool containsAnswer = solvePyramid(pyramid, iterationCount, cacheStatistics);
         if (containsAnswer)
+        {
+            std::cout << "\r\n* Hooray! Pyramid with N = " << pyramid.size() << " is complete\n";
+            std::cout << "Number of iterations: " << iterationCount << std::endl;
+            printPyramid(pyramid);
             answer++;
+        }
+        printCacheStatistics(cacheStatistics);
     }
     //std::cout << "ANSWER: " << answer << std::endl;
     //for (int i{}; i < nValuesWhereDisjointTrianglesCanBeCreated.size(); ++i)
@@ -1,12 +1,84 @@
+#include <algorithm>
+#include <atomic>
+#include <bitset>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <string>
+#include <thread>
 #include <tuple>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+// GCC's AVX-512 intrinsics pass _mm512_undefined_*() as the unused source of
+// their unmasked forms, which -Wmaybe-uninitialized reports inside the header
+// wherever they are inlined. The warning is switched off for the header only.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#endif
+
+/*
+ COMPILE WITH C++14 AND -pthread
+ Add -mavx2 (or -mavx512f) to get the vectorized trial kernel.
+*/
 
 namespace
 {
-    const unsigned NUMBER_OF_TRIALS = 10'000;
+    const unsigned long long NUMBER_OF_TRIALS = 10'000;
+
+    // Line lengths are swept from 0 up to sqrt(2) in steps of LENGTH_STEP.
+    const float LENGTH_STEP = 0.001f;
+    const int LENGTH_COUNT = static_cast<int>(std::sqrt(2) / LENGTH_STEP) + 1;
+
+    // Trials for one length are split into blocks of this size. Each block is
+    // one unit of work for the thread pool and draws from its own RNG stream.
+    const unsigned TRIALS_PER_BLOCK = 1 << 16;
+
+    // Uniforms are generated and evaluated in batches of this many trials, small
+    // enough for the three sample arrays to stay in L1.
+    const unsigned SAMPLE_BATCH = 1024;
+
+    // Taylor coefficients for sin and cos on [0, pi/4]. Truncating after these
+    // terms is off by less than 2e-9 (sin) and 3e-8 (cos), below float precision.
+    const float SIN_3 = -1.f / 6, SIN_5 = 1.f / 120, SIN_7 = -1.f / 5040, SIN_9 = 1.f / 362880;
+    const float COS_2 = -1.f / 2, COS_4 = 1.f / 24, COS_6 = -1.f / 720, COS_8 = 1.f / 40320;
+
+    // The adaptive optimizer starts on a grid of every ADAPTIVE_COARSE_STEP-th length
+    // and halves the spacing down to LENGTH_STEP around the best region.
+    const int ADAPTIVE_COARSE_STEP = 64;
+
+    // Lengths whose confidence intervals (at this many standard errors) overlap the
+    // best one keep getting more trials.
+    const double CONFIDENCE_Z = 2.576;
+
+    // Default absolute error target for the deterministic quadrature of one probability.
+    const double QUADRATURE_TOLERANCE = 1e-12;
+
+    // Adaptive Simpson can stop too early if its very first error estimate happens
+    // to be small, so every smooth piece of the integrand starts out split this often.
+    const int QUADRATURE_INITIAL_SPLITS = 4;
+
+    // Rounding in a double limits any one probability to about this absolute error,
+    // so --tolerance may not ask for less.
+    const double QUADRATURE_MIN_TOLERANCE = 1e-14;
+
+    // Deepest bisection of one piece; reaching it means the tolerance was not met there.
+    const int QUADRATURE_MAX_DEPTH = 25;
+
+    const size_t CSV_WRITE_BUFFER_BYTES = 1 << 20;
+
+    // Longest length the histogram supports; a trial then crosses at most 16 lines.
+    const double MAX_HISTOGRAM_LENGTH = 7;
 }
 
 
@@ -57,60 +129,1565 @@ namespace
  *    \________
  */
 
+// Runs body(i) for every i in [0, count), spread over one thread per core.
+void ParallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+    const unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<size_t> next{ 0 };
+    std::vector<std::thread> workers;
+    for (unsigned t{}; t < threadCount; ++t)
+    {
+        workers.emplace_back([&]()
+        {
+            for (size_t i = next++; i < count; i = next++)
+                body(i);
+        });
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+/*
+ * Sampling backends. Every block of trials reads its (x, y, u) samples from its
+ * own SampleStream, opened from the master seed, the replicate number and the
+ * block's position in the sweep. Which thread runs a block does not matter, so
+ * a run is reproducible from the master seed alone.
+ */
+
+enum class SamplerKind
+{
+    PseudoRandom, // std::mt19937
+    Philox,       // Philox4x32-10, counter based
+    Sobol,        // Sobol sequence, optionally Owen scrambled
+    Halton,       // Halton sequence in bases 2, 3 and 5, optionally randomly shifted
+};
+
+// Maps the top 24 bits of a 32-bit integer onto [0, 1).
+inline float ToUnitFloat(std::uint32_t bits)
+{
+    return (bits >> 8) * (1.f / 16777216.f);
+}
+
+class SampleStream
+{
+public:
+    virtual ~SampleStream() = default;
+    virtual void Fill(float* x, float* y, float* u, unsigned count) = 0;
+};
+
+class PseudoRandomStream : public SampleStream
+{
+public:
+    PseudoRandomStream(std::seed_seq& seed) : numberGenerator_(seed) {};
+
+    void Fill(float* x, float* y, float* u, unsigned count) override
+    {
+        for (float* uniforms : { x, y, u })
+            for (unsigned i{}; i < count; ++i)
+                uniforms[i] = ToUnitFloat(numberGenerator_());
+    }
+
+private:
+    std::mt19937 numberGenerator_;
+};
+
+/*
+ * Sobol points in three dimensions, generated in Gray code order. Direction
+ * numbers are Joe and Kuo's: dimension 1 is the van der Corput sequence,
+ * dimension 2 uses x + 1 with m = {1} and dimension 3 uses x^2 + x + 1 with
+ * m = {1, 3}. Blocks start at multiples of TRIALS_PER_BLOCK, a power of two,
+ * so each block covers the same points as in natural order.
+ *
+ * With scrambling on, each dimension gets a nested uniform (Owen) scramble,
+ * computed with Burley's hash-based approximation ("Practical Hash-based Owen
+ * Scrambling", 2020). Independent scrambles give independent unbiased
+ * estimates, which is where error bars for QMC come from.
+ */
+class SobolStream : public SampleStream
+{
+public:
+    SobolStream(std::uint32_t firstIndex, bool scrambled, std::seed_seq& seed) : index_(firstIndex), scrambled_(scrambled)
+    {
+        InitializeDirections();
+        seed.generate(scrambleSeeds_, scrambleSeeds_ + 3);
+        std::uint32_t gray = firstIndex ^ (firstIndex >> 1);
+        for (int dimension{}; dimension < 3; ++dimension)
+        {
+            point_[dimension] = 0;
+            for (int bit{}; bit < 32; ++bit)
+                if (gray >> bit & 1)
+                    point_[dimension] ^= directions_[dimension][bit];
+        }
+    }
+
+    void Fill(float* x, float* y, float* u, unsigned count) override
+    {
+        float* outputs[3] = { x, y, u };
+        for (unsigned i{}; i < count; ++i)
+        {
+            for (int dimension{}; dimension < 3; ++dimension)
+            {
+                std::uint32_t value = scrambled_ ? OwenScramble(point_[dimension], scrambleSeeds_[dimension]) : point_[dimension];
+                outputs[dimension][i] = ToUnitFloat(value);
+            }
+
+            // Step to the next point in Gray code order by flipping the direction
+            // number of the lowest zero bit of the current index.
+            int bit{};
+            while (index_ >> bit & 1)
+                ++bit;
+            ++index_;
+            for (int dimension{}; dimension < 3; ++dimension)
+                point_[dimension] ^= directions_[dimension][std::min(bit, 31)];
+        }
+    }
+
+private:
+    void InitializeDirections()
+    {
+        const int degree[3] = { 0, 1, 2 };
+        const std::uint32_t coefficients[3] = { 0, 0, 1 };
+        const std::uint32_t initial[3][2] = { { 0, 0 }, { 1, 0 }, { 1, 3 } };
+        for (int dimension{}; dimension < 3; ++dimension)
+        {
+            std::uint32_t* v = directions_[dimension];
+            const int s = degree[dimension];
+            for (int k{}; k < 32; ++k)
+            {
+                if (s == 0)
+                {
+                    v[k] = 1u << (31 - k);
+                }
+                else if (k < s)
+                {
+                    v[k] = initial[dimension][k] << (31 - k);
+                }
+                else
+                {
+                    v[k] = v[k - s] ^ (v[k - s] >> s);
+                    for (int j{ 1 }; j < s; ++j)
+                        if (coefficients[dimension] >> (s - 1 - j) & 1)
+                            v[k] ^= v[k - j];
+                }
+            }
+        }
+    }
+
+    static std::uint32_t ReverseBits(std::uint32_t value)
+    {
+        value = (value >> 16) | (value << 16);
+        value = ((value & 0xFF00FF00u) >> 8) | ((value & 0x00FF00FFu) << 8);
+        value = ((value & 0xF0F0F0F0u) >> 4) | ((value & 0x0F0F0F0Fu) << 4);
+        value = ((value & 0xCCCCCCCCu) >> 2) | ((value & 0x33333333u) << 2);
+        return ((value & 0xAAAAAAAAu) >> 1) | ((value & 0x55555555u) << 1);
+    }
+
+    static std::uint32_t OwenScramble(std::uint32_t value, std::uint32_t seed)
+    {
+        value = ReverseBits(value);
+        value += seed;
+        value ^= value * 0x6c50b47cu;
+        value ^= value * 0xb82f1e52u;
+        value ^= value * 0xc7afe638u;
+        value ^= value * 0x8d22f6e6u;
+        return ReverseBits(value);
+    }
+
+    std::uint32_t directions_[3][32];
+    std::uint32_t point_[3];
+    std::uint32_t scrambleSeeds_[3];
+    std::uint32_t index_;
+    bool scrambled_;
+};
+
+/*
+ * Halton points in bases 2, 3 and 5. With randomization on, every dimension is
+ * shifted by a random offset modulo 1 (a Cranley-Patterson rotation), which
+ * again makes independent replicates unbiased.
+ */
+class HaltonStream : public SampleStream
+{
+public:
+    HaltonStream(unsigned long long firstIndex, bool shifted, std::seed_seq& seed) : index_(firstIndex)
+    {
+        std::uint32_t shifts[3];
+        seed.generate(shifts, shifts + 3);
+        for (int dimension{}; dimension < 3; ++dimension)
+            shift_[dimension] = shifted ? shifts[dimension] / 4294967296. : 0.;
+    }
+
+    void Fill(float* x, float* y, float* u, unsigned count) override
+    {
+        const unsigned bases[3] = { 2, 3, 5 };
+        float* outputs[3] = { x, y, u };
+        for (unsigned i{}; i < count; ++i, ++index_)
+        {
+            for (int dimension{}; dimension < 3; ++dimension)
+            {
+                double value = RadicalInverse(index_, bases[dimension]) + shift_[dimension];
+                value -= std::floor(value);
+                outputs[dimension][i] = std::min(static_cast<float>(value), 1.f - std::numeric_limits<float>::epsilon() / 2);
+            }
+        }
+    }
+
+private:
+    static double RadicalInverse(unsigned long long index, unsigned base)
+    {
+        double inverse{}, digitWeight = 1. / base;
+        for (; index; index /= base, digitWeight /= base)
+            inverse += (index % base) * digitWeight;
+        return inverse;
+    }
+
+    unsigned long long index_;
+    double shift_[3];
+};
+
+/*
+ * Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2,
+ * 3", 2011). The output is a pure function of a 128-bit counter and a 64-bit
+ * key, so there is no state to seed or step through. Trial n of a given length
+ * and replicate is the block at counter (n, n >> 32, length, replicate) under
+ * key (master seed, 0). Any trial can be regenerated on its own, a block
+ * "skips ahead" by starting its counter at its first trial, and neighbouring
+ * trials are independent lanes of a SIMD register.
+ */
+
+namespace philox
+{
+    const std::uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+    const std::uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+    const int ROUNDS = 10;
+
+    inline void Block(std::uint32_t counter[4], std::uint32_t k0, std::uint32_t k1)
+    {
+        for (int round{}; round < ROUNDS; ++round)
+        {
+            std::uint64_t product0 = static_cast<std::uint64_t>(M0) * counter[0];
+            std::uint64_t product1 = static_cast<std::uint64_t>(M1) * counter[2];
+            std::uint32_t next[4] = {
+                static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^ k0, static_cast<std::uint32_t>(product1),
+                static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^ k1, static_cast<std::uint32_t>(product0) };
+            std::copy(next, next + 4, counter);
+            k0 += W0;
+            k1 += W1;
+        }
+    }
+}
+
+class PhiloxStream : public SampleStream
+{
+public:
+    PhiloxStream(std::uint32_t seed, unsigned long long firstTrial, unsigned lengthIndex, unsigned replicate)
+        : key_(seed), trial_(firstTrial), lengthIndex_(lengthIndex), replicate_(replicate) {};
+
+    void Fill(float* x, float* y, float* u, unsigned count) override
+    {
+        unsigned i{};
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+        // One trial per 32-bit lane. _mul_epu32 multiplies the even lanes into
+        // 64-bit products, so the odd lanes are shifted down and multiplied
+        // separately, then the high and low halves are blended back together.
+#if defined(__AVX512F__)
+        const unsigned LANES = 16;
+        typedef __m512i Vector;
+#define PHILOX_SET1(value) _mm512_set1_epi32(static_cast<int>(value))
+#define PHILOX_IOTA _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)
+#define PHILOX_ADD(a, b) _mm512_add_epi32(a, b)
+#define PHILOX_MUL_EVEN(a, b) _mm512_mul_epu32(a, b)
+#define PHILOX_SRLI64(a) _mm512_srli_epi64(a, 32)
+#define PHILOX_SLLI64(a) _mm512_slli_epi64(a, 32)
+#define PHILOX_BLEND_ODD(a, b) _mm512_mask_blend_epi32(0xAAAA, a, b)
+#define PHILOX_XOR(a, b) _mm512_xor_si512(a, b)
+#define PHILOX_STORE_UNIT(pointer, a) _mm512_storeu_ps(pointer, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_srli_epi32(a, 8)), _mm512_set1_ps(1.f / 16777216.f)))
+#else
+        const unsigned LANES = 8;
+        typedef __m256i Vector;
+#define PHILOX_SET1(value) _mm256_set1_epi32(static_cast<int>(value))
+#define PHILOX_IOTA _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)
+#define PHILOX_ADD(a, b) _mm256_add_epi32(a, b)
+#define PHILOX_MUL_EVEN(a, b) _mm256_mul_epu32(a, b)
+#define PHILOX_SRLI64(a) _mm256_srli_epi64(a, 32)
+#define PHILOX_SLLI64(a) _mm256_slli_epi64(a, 32)
+#define PHILOX_BLEND_ODD(a, b) _mm256_blend_epi32(a, b, 0xAA)
+#define PHILOX_XOR(a, b) _mm256_xor_si256(a, b)
+#define PHILOX_STORE_UNIT(pointer, a) _mm256_storeu_ps(pointer, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(a, 8)), _mm256_set1_ps(1.f / 16777216.f)))
+#endif
+        const Vector m0 = PHILOX_SET1(philox::M0), m1 = PHILOX_SET1(philox::M1);
+        // The low counter word must not wrap inside a vector; the scalar loop takes over if it would.
+        for (; i + LANES <= count && static_cast<std::uint32_t>(trial_) <= std::numeric_limits<std::uint32_t>::max() - LANES; i += LANES)
+        {
+            Vector c0 = PHILOX_ADD(PHILOX_SET1(static_cast<std::uint32_t>(trial_)), PHILOX_IOTA);
+            Vector c1 = PHILOX_SET1(trial_ >> 32), c2 = PHILOX_SET1(lengthIndex_), c3 = PHILOX_SET1(replicate_);
+            std::uint32_t k0 = key_, k1 = 0;
+            for (int round{}; round < philox::ROUNDS; ++round)
+            {
+                Vector even0 = PHILOX_MUL_EVEN(m0, c0), odd0 = PHILOX_MUL_EVEN(m0, PHILOX_SRLI64(c0));
+                Vector even1 = PHILOX_MUL_EVEN(m1, c2), odd1 = PHILOX_MUL_EVEN(m1, PHILOX_SRLI64(c2));
+                Vector high0 = PHILOX_BLEND_ODD(PHILOX_SRLI64(even0), odd0), low0 = PHILOX_BLEND_ODD(even0, PHILOX_SLLI64(odd0));
+                Vector high1 = PHILOX_BLEND_ODD(PHILOX_SRLI64(even1), odd1), low1 = PHILOX_BLEND_ODD(even1, PHILOX_SLLI64(odd1));
+                c0 = PHILOX_XOR(PHILOX_XOR(high1, c1), PHILOX_SET1(k0));
+                c1 = low1;
+                c2 = PHILOX_XOR(PHILOX_XOR(high0, c3), PHILOX_SET1(k1));
+                c3 = low0;
+                k0 += philox::W0;
+                k1 += philox::W1;
+            }
+            PHILOX_STORE_UNIT(x + i, c0);
+            PHILOX_STORE_UNIT(y + i, c1);
+            PHILOX_STORE_UNIT(u + i, c2);
+            trial_ += LANES;
+        }
+#undef PHILOX_SET1
+#undef PHILOX_IOTA
+#undef PHILOX_ADD
+#undef PHILOX_MUL_EVEN
+#undef PHILOX_SRLI64
+#undef PHILOX_SLLI64
+#undef PHILOX_BLEND_ODD
+#undef PHILOX_XOR
+#undef PHILOX_STORE_UNIT
+#endif
+
+        for (; i < count; ++i, ++trial_)
+        {
+            std::uint32_t counter[4] = { static_cast<std::uint32_t>(trial_), static_cast<std::uint32_t>(trial_ >> 32), lengthIndex_, replicate_ };
+            philox::Block(counter, key_, 0);
+            x[i] = ToUnitFloat(counter[0]);
+            y[i] = ToUnitFloat(counter[1]);
+            u[i] = ToUnitFloat(counter[2]);
+        }
+    }
+
+private:
+    std::uint32_t key_;
+    unsigned long long trial_;
+    std::uint32_t lengthIndex_, replicate_;
+};
+
+std::unique_ptr<SampleStream> OpenSampleStream(SamplerKind sampler, bool randomized, std::uint32_t masterSeed,
+    unsigned replicate, unsigned lengthIndex, unsigned blockIndex)
+{
+    const unsigned long long firstIndex = static_cast<unsigned long long>(blockIndex) * TRIALS_PER_BLOCK;
+    if (sampler == SamplerKind::Sobol)
+    {
+        // Every length sees the same points; only the scramble changes per replicate.
+        std::seed_seq seed{ masterSeed, static_cast<std::uint32_t>(replicate) };
+        return std::unique_ptr<SampleStream>(new SobolStream(static_cast<std::uint32_t>(firstIndex), randomized, seed));
+    }
+    if (sampler == SamplerKind::Halton)
+    {
+        std::seed_seq seed{ masterSeed, static_cast<std::uint32_t>(replicate) };
+        return std::unique_ptr<SampleStream>(new HaltonStream(firstIndex, randomized, seed));
+    }
+    if (sampler == SamplerKind::Philox)
+        return std::unique_ptr<SampleStream>(new PhiloxStream(masterSeed, firstIndex, lengthIndex, replicate));
+    std::seed_seq seed{ masterSeed, static_cast<std::uint32_t>(lengthIndex), static_cast<std::uint32_t>(blockIndex),
+        static_cast<std::uint32_t>(replicate) };
+    return std::unique_ptr<SampleStream>(new PseudoRandomStream(seed));
+}
+
+/*
+ * Counts the trials in a batch whose line crosses exactly one grid line.
+ * Trial i starts at (x[i], y[i]) with angle u[i] * pi / 4. If the end point
+ * is floor(x + d cos(t)) squares across and floor(y + d sin(t)) squares up,
+ * the line crossed that many grid lines on each axis. Both are non-negative
+ * here, so the trial counts when they add up to one.
+ */
+unsigned CountSingleCrossingsBatch(const float* x, const float* y, const float* u, unsigned count, float lineLength)
+{
+    unsigned timesOnlyOneLineCrosses{}, i{};
+
+#if defined(__AVX512F__)
+    const __m512 length16 = _mm512_set1_ps(lineLength), quarterPi16 = _mm512_set1_ps(M_PI / 4), one16 = _mm512_set1_ps(1.f);
+    for (; i + 16 <= count; i += 16)
+    {
+        __m512 t = _mm512_mul_ps(_mm512_loadu_ps(u + i), quarterPi16);
+        __m512 t2 = _mm512_mul_ps(t, t);
+        __m512 sinT = _mm512_fmadd_ps(t2, _mm512_set1_ps(SIN_9), _mm512_set1_ps(SIN_7));
+        sinT = _mm512_fmadd_ps(t2, sinT, _mm512_set1_ps(SIN_5));
+        sinT = _mm512_fmadd_ps(t2, sinT, _mm512_set1_ps(SIN_3));
+        sinT = _mm512_fmadd_ps(_mm512_mul_ps(t2, t), sinT, t);
+        __m512 cosT = _mm512_fmadd_ps(t2, _mm512_set1_ps(COS_8), _mm512_set1_ps(COS_6));
+        cosT = _mm512_fmadd_ps(t2, cosT, _mm512_set1_ps(COS_4));
+        cosT = _mm512_fmadd_ps(t2, cosT, _mm512_set1_ps(COS_2));
+        cosT = _mm512_fmadd_ps(t2, cosT, one16);
+        __m512 xCrosses = _mm512_roundscale_ps(_mm512_fmadd_ps(length16, cosT, _mm512_loadu_ps(x + i)), _MM_FROUND_TO_NEG_INF);
+        __m512 yCrosses = _mm512_roundscale_ps(_mm512_fmadd_ps(length16, sinT, _mm512_loadu_ps(y + i)), _MM_FROUND_TO_NEG_INF);
+        __mmask16 exactlyOne = _mm512_cmp_ps_mask(_mm512_add_ps(xCrosses, yCrosses), one16, _CMP_EQ_OQ);
+        timesOnlyOneLineCrosses += std::bitset<16>(exactlyOne).count();
+    }
+#elif defined(__AVX2__)
+    const __m256 length8 = _mm256_set1_ps(lineLength), quarterPi8 = _mm256_set1_ps(M_PI / 4), one8 = _mm256_set1_ps(1.f);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 t = _mm256_mul_ps(_mm256_loadu_ps(u + i), quarterPi8);
+        __m256 t2 = _mm256_mul_ps(t, t);
+        __m256 sinT = _mm256_add_ps(_mm256_mul_ps(t2, _mm256_set1_ps(SIN_9)), _mm256_set1_ps(SIN_7));
+        sinT = _mm256_add_ps(_mm256_mul_ps(t2, sinT), _mm256_set1_ps(SIN_5));
+        sinT = _mm256_add_ps(_mm256_mul_ps(t2, sinT), _mm256_set1_ps(SIN_3));
+        sinT = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(t2, t), sinT), t);
+        __m256 cosT = _mm256_add_ps(_mm256_mul_ps(t2, _mm256_set1_ps(COS_8)), _mm256_set1_ps(COS_6));
+        cosT = _mm256_add_ps(_mm256_mul_ps(t2, cosT), _mm256_set1_ps(COS_4));
+        cosT = _mm256_add_ps(_mm256_mul_ps(t2, cosT), _mm256_set1_ps(COS_2));
+        cosT = _mm256_add_ps(_mm256_mul_ps(t2, cosT), one8);
+        __m256 xCrosses = _mm256_floor_ps(_mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(length8, cosT)));
+        __m256 yCrosses = _mm256_floor_ps(_mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(length8, sinT)));
+        __m256 exactlyOne = _mm256_cmp_ps(_mm256_add_ps(xCrosses, yCrosses), one8, _CMP_EQ_OQ);
+        timesOnlyOneLineCrosses += std::bitset<8>(_mm256_movemask_ps(exactlyOne)).count();
+    }
+#endif
+
+    // Scalar fallback, and the tail of the batch on the vector paths.
+    for (; i < count; ++i)
+    {
+        float t = u[i] * static_cast<float>(M_PI / 4);
+        float t2 = t * t;
+        float sinT = t + t2 * t * (SIN_3 + t2 * (SIN_5 + t2 * (SIN_7 + t2 * SIN_9)));
+        float cosT = 1.f + t2 * (COS_2 + t2 * (COS_4 + t2 * (COS_6 + t2 * COS_8)));
+        int xCrosses = std::floor(x[i] + lineLength * cosT);
+        int yCrosses = std::floor(y[i] + lineLength * sinT);
+        if (xCrosses + yCrosses == 1)
+            ++timesOnlyOneLineCrosses;
+    }
+    return timesOnlyOneLineCrosses;
+}
+
+/*
+ * Lattice policies. A lattice is a template parameter of the engines below, so
+ * its crossing count is inlined into the trial loop instead of being a virtual
+ * call per trial. Each policy provides
+ *
+ *   ANGLE_RANGE      angles in [0, ANGLE_RANGE) cover every case up to symmetry
+ *   Start(u, v)      maps two uniforms onto a uniform start in a fundamental cell
+ *   Crossings(...)   lines crossed going from the start by (dx, dy)
+ *
+ * A start that is uniform over one period of the lattice is as good as one
+ * uniform over the whole plane. All cells have unit spacing or unit side.
+ */
+
+enum class LatticeKind
+{
+    Square,      // Unit squares; the original puzzle
+    Rectangular, // 1 by aspect rectangles
+    Triangular,  // Equilateral triangles of side 1
+    Hexagonal,   // Regular hexagons of side 1
+};
+
+struct SquareLattice
+{
+    static constexpr float ANGLE_RANGE = static_cast<float>(M_PI / 4);
+
+    void Start(float u, float v, float& x, float& y) const { x = u; y = v; }
+
+    int Crossings(float x, float y, float dx, float dy) const
+    {
+        return static_cast<int>(std::floor(x + dx)) + static_cast<int>(std::floor(y + dy));
+    }
+};
+
+struct RectangularLattice
+{
+    // Only the reflections survive, so a quarter turn of angles is needed.
+    static constexpr float ANGLE_RANGE = static_cast<float>(M_PI / 2);
+
+    float height_;
+
+    void Start(float u, float v, float& x, float& y) const { x = u; y = v * height_; }
+
+    int Crossings(float x, float y, float dx, float dy) const
+    {
+        return static_cast<int>(std::floor(x + dx)) + static_cast<int>(std::floor((y + dy) / height_));
+    }
+};
+
+// Three families of parallel lines, at 0, 60 and 120 degrees, sqrt(3) / 2 apart.
+struct TriangularLattice
+{
+    static constexpr float ANGLE_RANGE = static_cast<float>(M_PI / 6);
+
+    void Start(float u, float v, float& x, float& y) const { x = u + v / 2; y = v * static_cast<float>(std::sqrt(3) / 2); }
+
+    int Crossings(float x, float y, float dx, float dy) const
+    {
+        // Normals of the three families divided by the spacing, so each projection counts lines.
+        const float inverseRoot3 = static_cast<float>(1 / std::sqrt(3));
+        const float normals[3][2] = { { 0.f, 2 * inverseRoot3 }, { 1.f, -inverseRoot3 }, { 1.f, inverseRoot3 } };
+        int crossings{};
+        for (const float* normal : normals)
+        {
+            float from = x * normal[0] + y * normal[1];
+            float to = from + dx * normal[0] + dy * normal[1];
+            crossings += std::abs(static_cast<int>(std::floor(to)) - static_cast<int>(std::floor(from)));
+        }
+        return crossings;
+    }
+};
+
+/*
+ * Hexagons are the Voronoi cells of their centres, which form a triangular
+ * lattice. The start is placed relative to its nearest centre, then the line
+ * is walked cell to cell: the exit is the first bisector with a neighbouring
+ * centre it reaches, and every exit before the end is one edge crossed.
+ */
+struct HexagonalLattice
+{
+    static constexpr float ANGLE_RANGE = static_cast<float>(M_PI / 6);
+
+    // Offsets to the six neighbouring centres, all of length sqrt(3).
+    const float ROOT3 = static_cast<float>(std::sqrt(3));
+    const float NEIGHBOURS[6][2] = { { ROOT3, 0.f }, { -ROOT3, 0.f }, { ROOT3 / 2, 1.5f }, { -ROOT3 / 2, -1.5f },
+        { -ROOT3 / 2, 1.5f }, { ROOT3 / 2, -1.5f } };
+
+    // Uniform on the rhombus spanned by two neighbouring centres, relative to the nearest corner.
+    void Start(float u, float v, float& x, float& y) const
+    {
+        x = u * ROOT3 + v * ROOT3 / 2;
+        y = v * 1.5f;
+        float bestX = x, bestY = y;
+        for (const float* corner : { NEIGHBOURS[0], NEIGHBOURS[2] })
+        {
+            if ((x - corner[0]) * (x - corner[0]) + (y - corner[1]) * (y - corner[1]) < bestX * bestX + bestY * bestY)
+            {
+                bestX = x - corner[0];
+                bestY = y - corner[1];
+            }
+        }
+        float farX = x - NEIGHBOURS[0][0] - NEIGHBOURS[2][0], farY = y - NEIGHBOURS[0][1] - NEIGHBOURS[2][1];
+        if (farX * farX + farY * farY < bestX * bestX + bestY * bestY)
+        {
+            bestX = farX;
+            bestY = farY;
+        }
+        x = bestX;
+        y = bestY;
+    }
+
+    int Crossings(float x, float y, float dx, float dy) const
+    {
+        int crossings{};
+        while (true)
+        {
+            // (x, y) is relative to the current centre; the bisector with a neighbour n is p . n = 3 / 2.
+            float exit = 1.f;
+            int exitNeighbour = -1;
+            for (int k{}; k < 6; ++k)
+            {
+                float approach = dx * NEIGHBOURS[k][0] + dy * NEIGHBOURS[k][1];
+                if (approach <= 0)
+                    continue;
+                float reach = (1.5f - x * NEIGHBOURS[k][0] - y * NEIGHBOURS[k][1]) / approach;
+                if (reach < exit)
+                {
+                    exit = reach;
+                    exitNeighbour = k;
+                }
+            }
+            if (exitNeighbour < 0)
+                return crossings;
+            ++crossings;
+            x -= NEIGHBOURS[exitNeighbour][0];
+            y -= NEIGHBOURS[exitNeighbour][1];
+        }
+    }
+};
+
+template <class Lattice>
+unsigned CountSingleCrossingsBatch(const Lattice& lattice, const float* x, const float* y, const float* u, unsigned count, float lineLength)
+{
+    unsigned timesOnlyOneLineCrosses{};
+    for (unsigned i{}; i < count; ++i)
+    {
+        float t = u[i] * Lattice::ANGLE_RANGE, startX, startY;
+        lattice.Start(x[i], y[i], startX, startY);
+        if (lattice.Crossings(startX, startY, lineLength * std::cos(t), lineLength * std::sin(t)) == 1)
+            ++timesOnlyOneLineCrosses;
+    }
+    return timesOnlyOneLineCrosses;
+}
+
+// The square lattice keeps its vectorized kernel.
+inline unsigned CountSingleCrossingsBatch(const SquareLattice&, const float* x, const float* y, const float* u, unsigned count, float lineLength)
+{
+    return CountSingleCrossingsBatch(x, y, u, count, lineLength);
+}
+
+template <class Lattice>
+unsigned CountSingleCrossings(const Lattice& lattice, SampleStream& samples, float lineLength, unsigned trials)
+{
+    float x[SAMPLE_BATCH], y[SAMPLE_BATCH], u[SAMPLE_BATCH];
+    unsigned timesOnlyOneLineCrosses{};
+    for (unsigned done{}; done < trials; done += SAMPLE_BATCH)
+    {
+        unsigned count = std::min(SAMPLE_BATCH, trials - done);
+        samples.Fill(x, y, u, count);
+        timesOnlyOneLineCrosses += CountSingleCrossingsBatch(lattice, x, y, u, count, lineLength);
+    }
+    return timesOnlyOneLineCrosses;
+}
+
+enum class SampleReuse
+{
+    None,         // Fresh samples for every length
+    Common,       // One sample set per replicate, shared by every length
+    CommonSorted, // As Common, counted for all lengths at once from sorted crossing events
+};
+
+struct SimulationSettings
+{
+    std::uint32_t masterSeed;
+    unsigned long long trialsPerLength;
+    SamplerKind sampler;
+    bool randomized;     // Scramble (Sobol) or shift (Halton) the QMC points
+    unsigned replicates; // Independent repetitions, averaged and used for the standard error
+    SampleReuse reuse;
+};
+
+/*
+ * Common random numbers. Every length is tested against the same trials, so
+ * neighbouring lengths are compared without sampling noise between them and
+ * the argmax is much steadier. The samples are drawn once into flat arrays,
+ * with the angle already turned into its sine and cosine, so a length costs
+ * one multiply-add and floor per coordinate. Memory is 16 bytes per trial.
+ */
+
+// Counts the trials whose line of length lineLength crosses exactly one grid line.
+unsigned long long CountSingleCrossingsAtAngles(const float* x, const float* y, const float* cosT, const float* sinT,
+    size_t count, float lineLength)
+{
+    unsigned long long timesOnlyOneLineCrosses{};
+    size_t i{};
+
+#if defined(__AVX512F__)
+    const __m512 length16 = _mm512_set1_ps(lineLength), one16 = _mm512_set1_ps(1.f);
+    for (; i + 16 <= count; i += 16)
+    {
+        __m512 xCrosses = _mm512_roundscale_ps(_mm512_fmadd_ps(length16, _mm512_loadu_ps(cosT + i), _mm512_loadu_ps(x + i)), _MM_FROUND_TO_NEG_INF);
+        __m512 yCrosses = _mm512_roundscale_ps(_mm512_fmadd_ps(length16, _mm512_loadu_ps(sinT + i), _mm512_loadu_ps(y + i)), _MM_FROUND_TO_NEG_INF);
+        __mmask16 exactlyOne = _mm512_cmp_ps_mask(_mm512_add_ps(xCrosses, yCrosses), one16, _CMP_EQ_OQ);
+        timesOnlyOneLineCrosses += std::bitset<16>(exactlyOne).count();
+    }
+#elif defined(__AVX2__)
+    const __m256 length8 = _mm256_set1_ps(lineLength), one8 = _mm256_set1_ps(1.f);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 xCrosses = _mm256_floor_ps(_mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(length8, _mm256_loadu_ps(cosT + i))));
+        __m256 yCrosses = _mm256_floor_ps(_mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(length8, _mm256_loadu_ps(sinT + i))));
+        __m256 exactlyOne = _mm256_cmp_ps(_mm256_add_ps(xCrosses, yCrosses), one8, _CMP_EQ_OQ);
+        timesOnlyOneLineCrosses += std::bitset<8>(_mm256_movemask_ps(exactlyOne)).count();
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        int xCrosses = std::floor(x[i] + lineLength * cosT[i]);
+        int yCrosses = std::floor(y[i] + lineLength * sinT[i]);
+        if (xCrosses + yCrosses == 1)
+            ++timesOnlyOneLineCrosses;
+    }
+    return timesOnlyOneLineCrosses;
+}
+
+// Total grid lines crossed by one trial at the given length index.
+inline int CrossingsAtLengthIndex(float x, float y, float cosT, float sinT, int lengthIndex)
+{
+    float lineLength = lengthIndex * LENGTH_STEP;
+    return static_cast<int>(std::floor(x + lineLength * cosT)) + static_cast<int>(std::floor(y + lineLength * sinT));
+}
+
+/*
+ * The number of lines a trial crosses never decreases with the length, so it
+ * is described completely by the length indices where it reaches one, two,
+ * three, ... crossings. In particular the trial crosses exactly one line over
+ * the single run [first, second). The analytic guess for each index is
+ * corrected by evaluating the floors directly, so rounding at the boundary
+ * agrees with a length-by-length count. Returns lengthCount if the trial never
+ * gets there.
+ */
+inline int FirstLengthIndexWithCrossings(float x, float y, float cosT, float sinT, int lines, int lengthCount = LENGTH_COUNT)
+{
+    const float never = std::numeric_limits<float>::infinity();
+    float events[2 * 2 * (static_cast<int>(MAX_HISTOGRAM_LENGTH) + 1)];
+    int eventCount{};
+    for (int line{ 1 }; line <= lines; ++line)
+    {
+        events[eventCount++] = cosT > 0 ? (line - x) / cosT : never;
+        events[eventCount++] = sinT > 0 ? (line - y) / sinT : never;
+    }
+    std::nth_element(events, events + lines - 1, events + eventCount);
+    float guess = std::ceil(events[lines - 1] / LENGTH_STEP);
+    int lengthIndex = guess < lengthCount ? std::max(0, static_cast<int>(guess)) : lengthCount;
+
+    while (lengthIndex > 0 && CrossingsAtLengthIndex(x, y, cosT, sinT, lengthIndex - 1) >= lines)
+        --lengthIndex;
+    while (lengthIndex < lengthCount && CrossingsAtLengthIndex(x, y, cosT, sinT, lengthIndex) < lines)
+        ++lengthIndex;
+    return lengthIndex;
+}
+
+class CommonSamples
+{
+public:
+    CommonSamples(const SimulationSettings& settings, unsigned replicate)
+        : x_(settings.trialsPerLength), y_(settings.trialsPerLength), cosT_(settings.trialsPerLength), sinT_(settings.trialsPerLength)
+    {
+        ParallelFor(BlockCount(), [&](size_t blockIndex)
+        {
+            std::unique_ptr<SampleStream> samples = OpenSampleStream(settings.sampler, settings.randomized, settings.masterSeed,
+                replicate, 0, blockIndex);
+            float u[SAMPLE_BATCH];
+            for (size_t i = blockIndex * TRIALS_PER_BLOCK; i < BlockEnd(blockIndex); i += SAMPLE_BATCH)
+            {
+                unsigned count = std::min<size_t>(SAMPLE_BATCH, BlockEnd(blockIndex) - i);
+                samples->Fill(&x_[i], &y_[i], u, count);
+                for (unsigned j{}; j < count; ++j)
+                {
+                    float t = u[j] * static_cast<float>(M_PI / 4);
+                    cosT_[i + j] = std::cos(t);
+                    sinT_[i + j] = std::sin(t);
+                }
+            }
+        });
+    }
+
+    unsigned long long CountSingleCrossings(float lineLength) const
+    {
+        return CountSingleCrossingsAtAngles(x_.data(), y_.data(), cosT_.data(), sinT_.data(), x_.size(), lineLength);
+    }
+
+    // Counts for every length index at once. Each trial adds +1 where its run of
+    // single crossings starts and -1 where it ends; bucketing those events by
+    // length index and taking a running sum costs O(trials + LENGTH_COUNT)
+    // instead of O(trials * LENGTH_COUNT).
+    std::vector<unsigned long long> CountSingleCrossingsAtEveryLength() const
+    {
+        std::vector<std::vector<long long>> blockEvents(BlockCount());
+        ParallelFor(BlockCount(), [&](size_t blockIndex)
+        {
+            std::vector<long long>& events = blockEvents[blockIndex];
+            events.assign(LENGTH_COUNT + 1, 0);
+            for (size_t i = blockIndex * TRIALS_PER_BLOCK; i < BlockEnd(blockIndex); ++i)
+            {
+                int first = FirstLengthIndexWithCrossings(x_[i], y_[i], cosT_[i], sinT_[i], 1);
+                int second = FirstLengthIndexWithCrossings(x_[i], y_[i], cosT_[i], sinT_[i], 2);
+                ++events[first];
+                --events[second];
+            }
+        });
+
+        std::vector<unsigned long long> counts(LENGTH_COUNT);
+        long long running{};
+        for (int lengthIndex{}; lengthIndex < LENGTH_COUNT; ++lengthIndex)
+        {
+            for (const std::vector<long long>& events : blockEvents)
+                running += events[lengthIndex];
+            counts[lengthIndex] = running;
+        }
+        return counts;
+    }
+
+    // The same idea for every crossing count: histogram[lengthIndex * (maxCrossings + 1) + k]
+    // is the number of trials crossing k lines at that length. maxCrossings must be
+    // at least the most lines any trial can cross at the longest length.
+    std::vector<unsigned long long> CountCrossingsHistogram(int lengthCount, int maxCrossings) const
+    {
+        const int columns = maxCrossings + 1;
+        const size_t chunkCount = std::min<size_t>(BlockCount(), 4 * std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<std::vector<long long>> chunkEvents(chunkCount);
+        ParallelFor(chunkCount, [&](size_t chunk)
+        {
+            std::vector<long long>& events = chunkEvents[chunk];
+            events.assign((lengthCount + 1) * columns, 0);
+            for (size_t i = x_.size() * chunk / chunkCount; i < x_.size() * (chunk + 1) / chunkCount; ++i)
+            {
+                int start{};
+                for (int lines{}; lines < columns; ++lines)
+                {
+                    int end = lines < maxCrossings ? FirstLengthIndexWithCrossings(x_[i], y_[i], cosT_[i], sinT_[i], lines + 1, lengthCount) : lengthCount;
+                    ++events[start * columns + lines];
+                    --events[end * columns + lines];
+                    if (end == lengthCount)
+                        break;
+                    start = end;
+                }
+            }
+        });
+
+        std::vector<unsigned long long> histogram(lengthCount * columns);
+        std::vector<long long> running(columns);
+        for (int lengthIndex{}; lengthIndex < lengthCount; ++lengthIndex)
+        {
+            for (int lines{}; lines < columns; ++lines)
+            {
+                for (const std::vector<long long>& events : chunkEvents)
+                    running[lines] += events[lengthIndex * columns + lines];
+                histogram[lengthIndex * columns + lines] = running[lines];
+            }
+        }
+        return histogram;
+    }
+
+private:
+    size_t BlockCount() const { return (x_.size() + TRIALS_PER_BLOCK - 1) / TRIALS_PER_BLOCK; }
+    size_t BlockEnd(size_t blockIndex) const { return std::min<size_t>(x_.size(), (blockIndex + 1) * TRIALS_PER_BLOCK); }
+
+    std::vector<float> x_, y_, cosT_, sinT_;
+};
+
+struct SweepResult
+{
+    float maximumProbability;
+    float lineLength;
+    float standardError; // 0 with a single replicate
+};
+
+// Counts for every replicate and length, with fresh samples for every block of trials.
+template <class Lattice>
+std::vector<unsigned long long> CountSweep(const SimulationSettings& settings, const Lattice& lattice)
+{
+    // Test points within one cell of the lattice, trialsPerLength times for every length and replicate.
+    const unsigned long long trialsPerLength = settings.trialsPerLength;
+    const unsigned long long blocksPerLength = (trialsPerLength + TRIALS_PER_BLOCK - 1) / TRIALS_PER_BLOCK;
+    const unsigned long long blocksPerReplicate = LENGTH_COUNT * blocksPerLength;
+    std::vector<unsigned long long> blockCounts(settings.replicates * blocksPerReplicate);
+    ParallelFor(blockCounts.size(), [&](size_t unit)
+    {
+        unsigned replicate = unit / blocksPerReplicate;
+        unsigned lengthIndex = unit % blocksPerReplicate / blocksPerLength;
+        unsigned blockIndex = unit % blocksPerLength;
+        unsigned trials = std::min<unsigned long long>(TRIALS_PER_BLOCK, trialsPerLength - blockIndex * TRIALS_PER_BLOCK);
+        std::unique_ptr<SampleStream> samples = OpenSampleStream(settings.sampler, settings.randomized, settings.masterSeed,
+            replicate, lengthIndex, blockIndex);
+        blockCounts[unit] = CountSingleCrossings(lattice, *samples, lengthIndex * LENGTH_STEP, trials);
+    });
+
+    std::vector<unsigned long long> lengthCounts(settings.replicates * LENGTH_COUNT);
+    for (size_t unit{}; unit < blockCounts.size(); ++unit)
+        lengthCounts[unit / blocksPerLength] += blockCounts[unit];
+    return lengthCounts;
+}
+
+// The same counts from one common sample set per replicate. Square lattice only.
+std::vector<unsigned long long> CountSweepWithCommonSamples(const SimulationSettings& settings)
+{
+    std::vector<unsigned long long> lengthCounts(settings.replicates * LENGTH_COUNT);
+    for (unsigned replicate{}; replicate < settings.replicates; ++replicate)
+    {
+        CommonSamples samples(settings, replicate);
+        unsigned long long* counts = &lengthCounts[replicate * LENGTH_COUNT];
+        if (settings.reuse == SampleReuse::CommonSorted)
+        {
+            std::vector<unsigned long long> everyLength = samples.CountSingleCrossingsAtEveryLength();
+            std::copy(everyLength.begin(), everyLength.end(), counts);
+        }
+        else
+        {
+            ParallelFor(LENGTH_COUNT, [&](size_t lengthIndex)
+            {
+                counts[lengthIndex] = samples.CountSingleCrossings(lengthIndex * LENGTH_STEP);
+            });
+        }
+    }
+    return lengthCounts;
+}
+
+SweepResult MaxProbabilityOfCrossingExactlyOneLine(const SimulationSettings& settings, const std::vector<unsigned long long>& lengthCounts)
+{
+    const unsigned long long trialsPerLength = settings.trialsPerLength;
+    SweepResult result{};
+    for (int lengthIndex{}; lengthIndex < LENGTH_COUNT; ++lengthIndex)
+    {
+        // The probability a line of length lengthIndex * LENGTH_STEP crosses exactly one line,
+        // estimated once per replicate.
+        double sum{}, sumOfSquares{};
+        for (unsigned replicate{}; replicate < settings.replicates; ++replicate)
+        {
+            double probability = lengthCounts[replicate * LENGTH_COUNT + lengthIndex] / static_cast<double>(trialsPerLength);
+            sum += probability;
+            sumOfSquares += probability * probability;
+        }
+
+        float probabilityOfCrossing = sum / settings.replicates;
+        if (probabilityOfCrossing > result.maximumProbability)
+        {
+            result.lineLength = lengthIndex * LENGTH_STEP;
+            result.maximumProbability = probabilityOfCrossing;
+            if (settings.replicates > 1)
+            {
+                double variance = (sumOfSquares - sum * sum / settings.replicates) / (settings.replicates - 1);
+                result.standardError = std::sqrt(std::max(variance, 0.) / settings.replicates);
+            }
+        }
+    }
+
+    return result;
+}
+
+/*
+ * Adaptive search for the best length.
+ *
+ * Rather than spending the same number of trials everywhere, start with one
+ * block of trials on a coarse grid of lengths. Lengths whose confidence
+ * interval overlaps the best one are candidates; they get their trials doubled
+ * until the intervals separate or --trials is reached. The grid
+ * spacing is then halved over the interval spanned by the candidates, down to
+ * LENGTH_STEP. Standard errors are binomial, which is conservative for the
+ * QMC samplers.
+ *
+ * The answer is the best of the final candidates, and the length uncertainty
+ * spans all of them. The curve has a kink at its peak (flat to the left of
+ * d = 1, steep to the right), so a smooth fit through the candidates would be
+ * biased towards the flat side by more than its own error bars. Having been
+ * picked as the largest of many noisy estimates, the best candidate's own
+ * estimate is biased upwards too, so its probability is measured again on
+ * trials no length has seen.
+ */
+
+struct LengthEstimate
+{
+    unsigned long long blocks;
+    unsigned long long trials;
+    unsigned long long crossings;
+
+    double Probability() const { return trials ? crossings / static_cast<double>(trials) : 0.; }
+    double StandardError() const
+    {
+        double p = Probability();
+        return std::sqrt(std::max(p * (1 - p), 1. / trials) / trials);
+    }
+};
+
+struct AdaptiveResult
+{
+    double maximumProbability, probabilityError;
+    double lineLength, lengthError;
+    double lowestCandidate, highestCandidate;
+    unsigned long long totalTrials;
+};
+
+/*
+ * Grows every listed length to targetBlocks blocks of trials, running all new
+ * blocks in parallel. As in CountSweep, the last of the blocks that make up
+ * --trials is cut short, so no length ever gets more than --trials. Block b
+ * draws from sample stream block firstStreamBlock + b.
+ */
+template <class Lattice>
+void SampleLengths(const SimulationSettings& settings, const Lattice& lattice, std::map<int, LengthEstimate>& estimates,
+    const std::vector<int>& lengthIndices, unsigned long long targetBlocks, unsigned long long& totalTrials,
+    unsigned long long firstStreamBlock = 0)
+{
+    std::vector<std::pair<int, unsigned long long>> units; // (length index, block index)
+    for (int lengthIndex : lengthIndices)
+        for (unsigned long long block = estimates[lengthIndex].blocks; block < targetBlocks; ++block)
+            units.emplace_back(lengthIndex, block);
+
+    std::vector<unsigned long long> trials(units.size()), counts(units.size());
+    ParallelFor(units.size(), [&](size_t unit)
+    {
+        trials[unit] = std::min<unsigned long long>(TRIALS_PER_BLOCK, settings.trialsPerLength - units[unit].second * TRIALS_PER_BLOCK);
+        std::unique_ptr<SampleStream> samples = OpenSampleStream(settings.sampler, settings.randomized, settings.masterSeed,
+            0, units[unit].first, firstStreamBlock + units[unit].second);
+        counts[unit] = CountSingleCrossings(lattice, *samples, units[unit].first * LENGTH_STEP, static_cast<unsigned>(trials[unit]));
+    });
+
+    for (size_t unit{}; unit < units.size(); ++unit)
+    {
+        LengthEstimate& estimate = estimates[units[unit].first];
+        estimate.blocks = std::max(estimate.blocks, units[unit].second + 1);
+        estimate.trials += trials[unit];
+        estimate.crossings += counts[unit];
+        totalTrials += trials[unit];
+    }
+}
+
+template <class Lattice>
+AdaptiveResult AdaptiveMaxProbability(const SimulationSettings& settings, const Lattice& lattice)
+{
+    const unsigned long long maxBlocks = std::max(1ull, (settings.trialsPerLength + TRIALS_PER_BLOCK - 1) / TRIALS_PER_BLOCK);
+    std::map<int, LengthEstimate> estimates;
+    AdaptiveResult result{};
+    std::vector<int> candidates;
+    int low{}, high{ LENGTH_COUNT - 1 };
+
+    for (int step{ ADAPTIVE_COARSE_STEP }; step >= 1; step /= 2)
+    {
+        std::vector<int> grid;
+        for (int lengthIndex{ low }; lengthIndex <= high; lengthIndex += step)
+            grid.push_back(lengthIndex);
+        if (grid.back() != high)
+            grid.push_back(high);
+        SampleLengths(settings, lattice, estimates, grid, 1, result.totalTrials);
+
+        while (true)
+        {
+            int best = grid.front();
+            for (int lengthIndex : grid)
+                if (estimates[lengthIndex].Probability() > estimates[best].Probability())
+                    best = lengthIndex;
+
+            double threshold = estimates[best].Probability() - CONFIDENCE_Z * estimates[best].StandardError();
+            candidates.clear();
+            std::vector<int> undecided;
+            for (int lengthIndex : grid)
+            {
+                if (estimates[lengthIndex].Probability() + CONFIDENCE_Z * estimates[lengthIndex].StandardError() >= threshold)
+                {
+                    candidates.push_back(lengthIndex);
+                    if (estimates[lengthIndex].blocks < maxBlocks)
+                        undecided.push_back(lengthIndex);
+                }
+            }
+            if (candidates.size() == 1 || undecided.empty())
+                break;
+
+            unsigned long long targetBlocks = maxBlocks;
+            for (int lengthIndex : undecided)
+                targetBlocks = std::min(targetBlocks, 2 * estimates[lengthIndex].blocks);
+            SampleLengths(settings, lattice, estimates, undecided, targetBlocks, result.totalTrials);
+        }
+
+        low = std::max(0, candidates.front() - step);
+        high = std::min(LENGTH_COUNT - 1, candidates.back() + step);
+    }
+
+    result.lowestCandidate = candidates.front() * LENGTH_STEP;
+    result.highestCandidate = candidates.back() * LENGTH_STEP;
+
+    int best = candidates.front();
+    for (int lengthIndex : candidates)
+        if (estimates[lengthIndex].Probability() > estimates[best].Probability())
+            best = lengthIndex;
+
+    // Any candidate may be the true peak, so the error reaches the farther end of the interval.
+    result.lineLength = best * LENGTH_STEP;
+    result.lengthError = std::max(result.lineLength - result.lowestCandidate, result.highestCandidate - result.lineLength);
+
+    // Stream blocks from maxBlocks on were never drawn for any length.
+    std::map<int, LengthEstimate> confirmation;
+    SampleLengths(settings, lattice, confirmation, { best }, estimates[best].blocks, result.totalTrials, maxBlocks);
+    result.maximumProbability = confirmation[best].Probability();
+    result.probabilityError = confirmation[best].StandardError();
+    return result;
+}
+
+/*
+ * Deterministic reference.
+ *
+ * For a fixed angle t the line reaches a = d cos(t) across and b = d sin(t) up.
+ * With x uniform on [0, 1), floor(x + a) is floor(a) with probability
+ * 1 - frac(a) and floor(a) + 1 with probability frac(a), and likewise for y, so
+ * the inner integral over the starting point is exact. What remains is a one
+ * dimensional integral over t whose integrand is smooth except where a or b
+ * is a whole number. Splitting [0, pi/4] at those angles and integrating each
+ * piece with adaptive Simpson gives the probability to the requested tolerance
+ * (QUADRATURE_TOLERANCE unless --tolerance says otherwise). Each piece gets a
+ * share of the tolerance in proportion to its width.
+ *
+ * For d <= 1 the integral is (4 / pi)(d - d^2 / 2), which checks the rest.
+ */
+
+// Probability over the starting point that reaches a across and b up cross exactly one line.
+double SingleCrossingProbability(double a, double b)
+{
+    double wholeA = std::floor(a), fractionA = a - wholeA;
+    double wholeB = std::floor(b), fractionB = b - wholeB;
+    double probability{};
+    for (int stepA{}; stepA < 2; ++stepA)
+        for (int stepB{}; stepB < 2; ++stepB)
+            if (wholeA + stepA + wholeB + stepB == 1)
+                probability += (stepA ? fractionA : 1 - fractionA) * (stepB ? fractionB : 1 - fractionB);
+    return probability;
+}
 
-// d is the length of the hypoteneus. t is the angle relative to 
-// the X axis of the grid.
-bool IsLineOnOneGridLine(float x, float y, float d, float t)
+// Counts in depthLimitHits every interval accepted only because depth ran out.
+double AdaptiveSimpson(const std::function<double(double)>& f, double low, double high,
+    double fLow, double fMiddle, double fHigh, double whole, double tolerance, int depth, int& depthLimitHits)
 {
-    // If x + d * std::cos(t) is greater than 1, we have the line segment crossing on the x axis
-    // In other words, we extend beyond the square length.
-    // If we cross on the x and y axis (xCrosses + yCrosses > 1)
-    // then we breached more than one lines.
-    int xCrosses = std::abs(std::floor(x + d * std::cos(t)));
-    int yCrosses = std::abs(std::floor(y + d * std::sin(t)));
-    return xCrosses + yCrosses == 1;
+    double middle = (low + high) / 2;
+    double fLeft = f((low + middle) / 2), fRight = f((middle + high) / 2);
+    double left = (middle - low) / 6 * (fLow + 4 * fLeft + fMiddle);
+    double right = (high - middle) / 6 * (fMiddle + 4 * fRight + fHigh);
+    if (std::abs(left + right - whole) <= 15 * tolerance)
+        return left + right + (left + right - whole) / 15;
+    if (depth <= 0)
+    {
+        ++depthLimitHits;
+        return left + right + (left + right - whole) / 15;
+    }
+    return AdaptiveSimpson(f, low, middle, fLow, fLeft, fMiddle, left, tolerance / 2, depth - 1, depthLimitHits) +
+        AdaptiveSimpson(f, middle, high, fMiddle, fRight, fHigh, right, tolerance / 2, depth - 1, depthLimitHits);
 }
 
-std::tuple<float, float> MaxProbabilityOfCrossingExactlyOneLine()
+// Adds to *depthLimitHits, when given, the pieces that stopped at QUADRATURE_MAX_DEPTH.
+double QuadratureProbability(double lineLength, double tolerance = QUADRATURE_TOLERANCE, int* depthLimitHits = nullptr)
 {
-    // Test random points within this 1 by 1 square.
-    // Hence we need a random number generator.
-    std::random_device seed;
-    std::mt19937 numberGenerator(seed());
-    std::uniform_real_distribution<float> uniformDist(0, 1);
+    const double quarterPi = M_PI / 4;
 
-    auto RandomNumber = [&](std::uniform_real_distribution<float> dist){ return 0 + dist(numberGenerator);};
+    // Angles where d cos(t) or d sin(t) is a whole number.
+    std::vector<double> breaks{ 0., quarterPi };
+    for (int k{ 1 }; k <= lineLength; ++k)
+    {
+        breaks.push_back(std::acos(k / lineLength));
+        breaks.push_back(std::asin(k / lineLength));
+    }
+    std::sort(breaks.begin(), breaks.end());
 
-    float maximumProbability{}, lineLength{};
-    for (float startingLength{}; startingLength < 1 * std::sqrt(2); startingLength += 0.001)
+    std::function<double(double)> integrand = [lineLength](double t)
+    {
+        return SingleCrossingProbability(lineLength * std::cos(t), lineLength * std::sin(t));
+    };
+    double integral{};
+    int limitHits{};
+    for (size_t i{ 1 }; i < breaks.size(); ++i)
     {
-        int timesOnlyOneLineCrosses{};
-        for (unsigned trialCount{}; trialCount < NUMBER_OF_TRIALS; ++trialCount)
+        double pieceLow = breaks[i - 1], pieceHigh = std::min(breaks[i], quarterPi);
+        if (pieceHigh <= pieceLow)
+            continue;
+        for (int split{}; split < QUADRATURE_INITIAL_SPLITS; ++split)
         {
-            if (IsLineOnOneGridLine(RandomNumber(uniformDist), RandomNumber(uniformDist),
-             startingLength, RandomNumber(uniformDist) * M_PI / 4))
-             {
-                ++timesOnlyOneLineCrosses;
-             }
+            double low = pieceLow + (pieceHigh - pieceLow) * split / QUADRATURE_INITIAL_SPLITS;
+            double high = pieceLow + (pieceHigh - pieceLow) * (split + 1) / QUADRATURE_INITIAL_SPLITS;
+            double fLow = integrand(low), fMiddle = integrand((low + high) / 2), fHigh = integrand(high);
+            double whole = (high - low) / 6 * (fLow + 4 * fMiddle + fHigh);
+            integral += AdaptiveSimpson(integrand, low, high, fLow, fMiddle, fHigh, whole, tolerance * (high - low),
+                QUADRATURE_MAX_DEPTH, limitHits);
         }
+    }
+    if (depthLimitHits)
+        *depthLimitHits += limitHits;
+    return integral / quarterPi;
+}
 
-        // The probability a line of length startingLength crosses exactly one line.
-        float probabilityOfCrossing = timesOnlyOneLineCrosses / static_cast<float>(NUMBER_OF_TRIALS);
+struct ReferenceResult
+{
+    double maximumProbability;
+    double lineLength;
+    double maximumCheckError; // Largest deviation from the closed form over lengths up to 1
+    int depthLimitHits;       // Quadrature pieces that stopped short of the tolerance
+};
 
-        if (probabilityOfCrossing > maximumProbability)
+// Sweeps the same grid as the simulation, then refines the best length by golden section search.
+ReferenceResult ReferenceMaxProbability(double tolerance)
+{
+    std::vector<double> probabilities(LENGTH_COUNT);
+    std::vector<int> depthLimitHits(LENGTH_COUNT);
+    ParallelFor(LENGTH_COUNT, [&](size_t lengthIndex)
+    {
+        probabilities[lengthIndex] = QuadratureProbability(lengthIndex * static_cast<double>(LENGTH_STEP), tolerance,
+            &depthLimitHits[lengthIndex]);
+    });
+
+    ReferenceResult result{};
+    int best{};
+    for (int lengthIndex{}; lengthIndex < LENGTH_COUNT; ++lengthIndex)
+    {
+        result.depthLimitHits += depthLimitHits[lengthIndex];
+        double lineLength = lengthIndex * static_cast<double>(LENGTH_STEP);
+        if (lineLength <= 1)
         {
-            lineLength = startingLength;
-            maximumProbability = probabilityOfCrossing;
+            double exact = 4 / M_PI * (lineLength - lineLength * lineLength / 2);
+            result.maximumCheckError = std::max(result.maximumCheckError, std::abs(probabilities[lengthIndex] - exact));
         }
+        if (probabilities[lengthIndex] > probabilities[best])
+            best = lengthIndex;
     }
 
-    return {maximumProbability, lineLength};
+    const double inverseGolden = (std::sqrt(5.) - 1) / 2;
+    double low = std::max(0, best - 1) * static_cast<double>(LENGTH_STEP);
+    double high = std::min(LENGTH_COUNT - 1, best + 1) * static_cast<double>(LENGTH_STEP);
+    while (high - low > 1e-9)
+    {
+        double left = high - inverseGolden * (high - low), right = low + inverseGolden * (high - low);
+        if (QuadratureProbability(left, tolerance, &result.depthLimitHits) < QuadratureProbability(right, tolerance, &result.depthLimitHits))
+            low = left;
+        else
+            high = right;
+    }
+    result.lineLength = (low + high) / 2;
+    result.maximumProbability = QuadratureProbability(result.lineLength, tolerance, &result.depthLimitHits);
+    return result;
 }
 
-int main()
+/*
+ * Full distribution of the number of lines crossed, for lengths from 0 to
+ * maxLength, counted in one pass over a common sample set and written as CSV:
+ * one row per length, one column per crossing count.
+ */
+
+class CsvWriter
+{
+public:
+    CsvWriter(const std::string& path) : output_(path, std::ios::binary) { buffer_.reserve(CSV_WRITE_BUFFER_BYTES); }
+    ~CsvWriter() { Flush(); }
+
+    bool IsOpen() const { return output_.is_open(); }
+
+    void WriteRow(const std::string& row)
+    {
+        if (buffer_.size() + row.size() + 1 > CSV_WRITE_BUFFER_BYTES)
+            Flush();
+        buffer_ += row;
+        buffer_ += '\n';
+    }
+
+    void Flush()
+    {
+        output_.write(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+
+private:
+    std::ofstream output_;
+    std::string buffer_;
+};
+
+int WriteCrossingsHistogram(const SimulationSettings& settings, double maxLength, const std::string& path)
 {
-    std::tuple<float, float> result = MaxProbabilityOfCrossingExactlyOneLine();
-    std::cout << "---------------------- Maximum Probability " << std::get<0>(result) << " Line Length: " << std::get<1>(result) << " ----------------------" << std::endl;
+    CsvWriter writer(path);
+    if (!writer.IsOpen())
+    {
+        std::cout << "Could not open " << path << std::endl;
+        return 1;
+    }
+
+    // Both floors are at most floor(1 + maxLength).
+    const int lengthCount = static_cast<int>(maxLength / LENGTH_STEP) + 1;
+    const int maxCrossings = 2 * (static_cast<int>(maxLength) + 1);
+    std::vector<unsigned long long> histogram = CommonSamples(settings, 0).CountCrossingsHistogram(lengthCount, maxCrossings);
+
+    std::string row = "line_length";
+    for (int lines{}; lines <= maxCrossings; ++lines)
+        row += ",p" + std::to_string(lines);
+    writer.WriteRow(row);
+
+    char cell[32];
+    for (int lengthIndex{}; lengthIndex < lengthCount; ++lengthIndex)
+    {
+        std::snprintf(cell, sizeof(cell), "%.3f", lengthIndex * LENGTH_STEP);
+        row = cell;
+        for (int lines{}; lines <= maxCrossings; ++lines)
+        {
+            std::snprintf(cell, sizeof(cell), ",%.9g", histogram[lengthIndex * (maxCrossings + 1) + lines] / static_cast<double>(settings.trialsPerLength));
+            row += cell;
+        }
+        writer.WriteRow(row);
+    }
+    return 0;
 }
 
+/*
+ * Sweep with early stopping. Every length draws blocks of trials one at a time
+ * and folds each block into a running mean and variance (Welford's update,
+ * merged a block at a time with Chan's formula). Once the confidence interval
+ * at CONFIDENCE_Z is narrower than +-targetError, or --trials is reached, the
+ * length stops. As in LengthEstimate, the variance is floored at 1/n, so a
+ * block with no crossings (or nothing but) still gets an interval about
+ * CONFIDENCE_Z / n wide rather than none at all. A JSON line describing each
+ * finished length can be streamed to a progress file.
+ */
+
+struct ConvergenceMonitor
+{
+    unsigned long long count_;
+    double mean_;
+    double sumOfSquares_; // Sum of squared deviations from the mean
+
+    // Folds in a batch of 0/1 outcomes with the given number of ones.
+    void AddBatch(unsigned long long count, unsigned long long ones)
+    {
+        if (count == 0)
+            return;
+        double batchMean = ones / static_cast<double>(count);
+        double batchSumOfSquares = count * batchMean * (1 - batchMean);
+        double delta = batchMean - mean_;
+        unsigned long long total = count_ + count;
+        mean_ += delta * count / total;
+        sumOfSquares_ += batchSumOfSquares + delta * delta * count_ * count / total;
+        count_ = total;
+    }
+
+    double StandardError() const
+    {
+        if (count_ < 2)
+            return std::numeric_limits<double>::infinity();
+        return std::sqrt(std::max(sumOfSquares_ / (count_ - 1), 1. / count_) / count_);
+    }
+
+    double HalfWidth() const { return CONFIDENCE_Z * StandardError(); }
+};
+
+struct MonitoredResult
+{
+    double maximumProbability, standardError, lineLength;
+    unsigned long long totalTrials;
+    int lengthsStoppedEarly;
+};
+
+template <class Lattice>
+MonitoredResult MonitoredMaxProbability(const SimulationSettings& settings, const Lattice& lattice, double targetError,
+    std::ostream* progress)
+{
+    const unsigned long long maxBlocks = std::max(1ull, (settings.trialsPerLength + TRIALS_PER_BLOCK - 1) / TRIALS_PER_BLOCK);
+    std::vector<ConvergenceMonitor> monitors(LENGTH_COUNT, ConvergenceMonitor{});
+    std::mutex progressMutex;
+    int lengthsDone{};
+    unsigned long long trialsDone{};
+
+    ParallelFor(LENGTH_COUNT, [&](size_t lengthIndex)
+    {
+        ConvergenceMonitor& monitor = monitors[lengthIndex];
+        for (unsigned long long block{}; block < maxBlocks; ++block)
+        {
+            unsigned trials = std::min<unsigned long long>(TRIALS_PER_BLOCK, settings.trialsPerLength - block * TRIALS_PER_BLOCK);
+            std::unique_ptr<SampleStream> samples = OpenSampleStream(settings.sampler, settings.randomized, settings.masterSeed,
+                0, lengthIndex, block);
+            monitor.AddBatch(trials, CountSingleCrossings(lattice, *samples, lengthIndex * LENGTH_STEP, trials));
+            if (monitor.HalfWidth() <= targetError)
+                break;
+        }
+
+        std::lock_guard<std::mutex> lock(progressMutex);
+        ++lengthsDone;
+        trialsDone += monitor.count_;
+        if (progress)
+        {
+            char line[256];
+            std::snprintf(line, sizeof(line),
+                "{\"length\":%.3f,\"trials\":%llu,\"probability\":%.9g,\"half_width\":%.3g,\"converged\":%s,\"lengths_done\":%d,\"total_trials\":%llu}",
+                lengthIndex * LENGTH_STEP, monitor.count_, monitor.mean_, monitor.HalfWidth(),
+                monitor.HalfWidth() <= targetError ? "true" : "false", lengthsDone, trialsDone);
+            *progress << line << std::endl;
+        }
+    });
+
+    MonitoredResult result{};
+    for (int lengthIndex{}; lengthIndex < LENGTH_COUNT; ++lengthIndex)
+    {
+        const ConvergenceMonitor& monitor = monitors[lengthIndex];
+        result.totalTrials += monitor.count_;
+        if (monitor.count_ < settings.trialsPerLength)
+            ++result.lengthsStoppedEarly;
+        if (monitor.mean_ > result.maximumProbability)
+        {
+            result.maximumProbability = monitor.mean_;
+            result.standardError = monitor.StandardError();
+            result.lineLength = lengthIndex * LENGTH_STEP;
+        }
+    }
+    return result;
+}
+
+// Calls engine with the chosen lattice policy; each lattice gets its own instantiation of the engine.
+template <class Engine>
+auto WithLattice(LatticeKind kind, float aspect, Engine engine)
+{
+    switch (kind)
+    {
+    case LatticeKind::Rectangular:
+        return engine(RectangularLattice{ aspect });
+    case LatticeKind::Triangular:
+        return engine(TriangularLattice{});
+    case LatticeKind::Hexagonal:
+        return engine(HexagonalLattice{});
+    default:
+        return engine(SquareLattice{});
+    }
+}
+
+void PrintUsage()
+{
+    std::cout << "Usage: solution [--seed <master seed>] [--trials <trials per length>]\n"
+        << "                [--sampler philox|mt|sobol|halton] [--randomize 0|1] [--replicates <count>]\n"
+        << "                [--adaptive 1] [--common 0|1|sorted] [--reference 1]\n"
+        << "                [--reference-length <d>] [--tolerance <absolute error>]\n"
+        << "                [--histogram <csv file>] [--max-length <d>]\n"
+        << "                [--lattice square|rectangular|triangular|hexagonal] [--aspect <height>]\n"
+        << "                [--target-error <half width>] [--progress <jsonl file>|-]" << std::endl;
+}
+
+/*
+ * solution [--seed <master seed>] [--trials <trials per length>]
+ *          [--sampler philox|mt|sobol|halton] [--randomize 0|1] [--replicates <count>]
+ *          [--adaptive 1] [--common 0|1|sorted] [--reference 1]
+ *          [--reference-length <d>] [--tolerance <absolute error>]
+ *          [--histogram <csv file>] [--max-length <d>]
+ *          [--lattice square|rectangular|triangular|hexagonal] [--aspect <height>]
+ *          [--target-error <half width>] [--progress <jsonl file>|-]
+ *
+ * With --adaptive 1, --trials is the most trials any single length may get
+ * during the search; the chosen length is then measured again on fresh trials.
+ * --common reuses one set of trials for every length of the full sweep;
+ * "sorted" also counts all lengths in a single pass over the trials.
+ * --reference 1 skips the simulation and prints the quadrature answer.
+ * --reference-length prints the quadrature probability at one length instead.
+ * Both are accurate to --tolerance (default 1e-12, at least 1e-14).
+ * --histogram writes the distribution of crossings for lengths up to
+ * --max-length (default sqrt(2)) from one common sample set.
+ * --common, --histogram and the references rely on the square lattice.
+ * --target-error stops each length of the sweep once its confidence interval
+ * is that narrow; --trials is then the most any length may use.
+ */
+int main(int argc, char* argv[])
+{
+    SimulationSettings settings{ std::random_device{}(), NUMBER_OF_TRIALS, SamplerKind::Philox, true, 1, SampleReuse::None };
+    bool adaptive{}, reference{};
+    double referenceLength = -1, tolerance = QUADRATURE_TOLERANCE;
+    std::string histogramPath;
+    double maxLength = std::sqrt(2);
+    LatticeKind lattice = LatticeKind::Square;
+    float aspect = 1.f;
+    double targetError{};
+    std::string progressPath;
+    for (int i{ 1 }; i < argc; i += 2)
+    {
+        if (i + 1 == argc)
+        {
+            std::cout << argv[i] << " needs a value" << std::endl;
+            PrintUsage();
+            return 1;
+        }
+        std::string option(argv[i]), value(argv[i + 1]);
+        if (option == "--seed")
+            settings.masterSeed = static_cast<std::uint32_t>(std::stoul(value));
+        else if (option == "--trials")
+            settings.trialsPerLength = std::stoull(value);
+        else if (option == "--sampler")
+            settings.sampler = value == "sobol" ? SamplerKind::Sobol : value == "halton" ? SamplerKind::Halton :
+                value == "mt" ? SamplerKind::PseudoRandom : SamplerKind::Philox;
+        else if (option == "--randomize")
+            settings.randomized = value != "0";
+        else if (option == "--replicates")
+            settings.replicates = std::max(1ul, std::stoul(value));
+        else if (option == "--adaptive")
+            adaptive = value != "0";
+        else if (option == "--lattice")
+            lattice = value == "rectangular" ? LatticeKind::Rectangular : value == "triangular" ? LatticeKind::Triangular :
+                value == "hexagonal" ? LatticeKind::Hexagonal : LatticeKind::Square;
+        else if (option == "--aspect")
+            aspect = std::stof(value);
+        else if (option == "--target-error")
+            targetError = std::stod(value);
+        else if (option == "--progress")
+            progressPath = value;
+        else if (option == "--histogram")
+            histogramPath = value;
+        else if (option == "--max-length")
+            maxLength = std::min(MAX_HISTOGRAM_LENGTH, std::max(0., std::stod(value)));
+        else if (option == "--reference")
+            reference = value != "0";
+        else if (option == "--reference-length")
+            referenceLength = std::stod(value);
+        else if (option == "--tolerance")
+            tolerance = std::stod(value);
+        else if (option == "--common")
+            settings.reuse = value == "sorted" ? SampleReuse::CommonSorted : value == "0" ? SampleReuse::None : SampleReuse::Common;
+        else
+        {
+            std::cout << "Unknown option: " << option << std::endl;
+            PrintUsage();
+            return 1;
+        }
+    }
+    // The adaptive search draws up to twice --trials from each length's stream.
+    if (settings.sampler == SamplerKind::Sobol && settings.trialsPerLength > std::numeric_limits<std::uint32_t>::max() / (adaptive ? 2 : 1))
+    {
+        std::cout << "The Sobol sampler supports at most 2^32 trials per length (2^31 with --adaptive)" << std::endl;
+        return 1;
+    }
+
+    if (lattice != LatticeKind::Square && (reference || referenceLength >= 0 || !histogramPath.empty() || settings.reuse != SampleReuse::None))
+    {
+        std::cout << "--common, --histogram, --reference and --reference-length are only available on the square lattice" << std::endl;
+        return 1;
+    }
+    if (!(tolerance >= QUADRATURE_MIN_TOLERANCE))
+    {
+        std::cout << "--tolerance must be at least " << QUADRATURE_MIN_TOLERANCE << std::endl;
+        return 1;
+    }
+
+    if (referenceLength >= 0)
+    {
+        int depthLimitHits{};
+        double probability = QuadratureProbability(referenceLength, tolerance, &depthLimitHits);
+        std::cout.precision(std::max(6, static_cast<int>(std::ceil(-std::log10(tolerance))) + 1));
+        std::cout << "Probability of crossing exactly one line at length " << referenceLength << ": "
+            << probability << " (tolerance " << tolerance << ")" << std::endl;
+        if (depthLimitHits)
+            std::cout << "Warning: " << depthLimitHits << " quadrature pieces reached depth " << QUADRATURE_MAX_DEPTH
+                << " before meeting the tolerance" << std::endl;
+        if (referenceLength <= 1)
+            std::cout << "Closed form (4 / pi)(d - d^2 / 2): " << 4 / M_PI * (referenceLength - referenceLength * referenceLength / 2) << std::endl;
+        return 0;
+    }
+    if (!(aspect > 0))
+    {
+        std::cout << "--aspect must be positive" << std::endl;
+        return 1;
+    }
+
+    if (reference)
+    {
+        ReferenceResult result = ReferenceMaxProbability(tolerance);
+        std::cout.precision(12);
+        std::cout << "---------------------- Maximum Probability " << result.maximumProbability << " Line Length: " << result.lineLength << " ----------------------" << std::endl;
+        std::cout << "Largest error against (4 / pi)(d - d^2 / 2) for d <= 1: " << result.maximumCheckError << std::endl;
+        if (result.depthLimitHits)
+            std::cout << "Warning: " << result.depthLimitHits << " quadrature pieces reached depth " << QUADRATURE_MAX_DEPTH
+                << " before meeting the tolerance" << std::endl;
+        return 0;
+    }
+
+    std::cout << "Master seed: " << settings.masterSeed << " Trials per length: " << settings.trialsPerLength
+        << " Replicates: " << settings.replicates << std::endl;
+    if (!histogramPath.empty())
+        return WriteCrossingsHistogram(settings, maxLength, histogramPath);
+    if (adaptive)
+    {
+        AdaptiveResult result = WithLattice(lattice, aspect, [&](const auto& policy) { return AdaptiveMaxProbability(settings, policy); });
+        std::cout << "---------------------- Maximum Probability " << result.maximumProbability << " +- " << result.probabilityError
+            << " Line Length: " << result.lineLength << " +- " << result.lengthError << " ----------------------" << std::endl;
+        std::cout << "Candidate lengths: [" << result.lowestCandidate << ", " << result.highestCandidate << "] Total trials: "
+            << result.totalTrials << " (a full sweep would use " << LENGTH_COUNT * settings.trialsPerLength << ")" << std::endl;
+        return 0;
+    }
+
+    if (targetError > 0)
+    {
+        std::ofstream progressFile;
+        std::ostream* progress = nullptr;
+        if (progressPath == "-")
+            progress = &std::cout;
+        else if (!progressPath.empty())
+        {
+            progressFile.open(progressPath);
+            if (!progressFile.is_open())
+            {
+                std::cout << "Could not open " << progressPath << std::endl;
+                return 1;
+            }
+            progress = &progressFile;
+        }
+
+        MonitoredResult result = WithLattice(lattice, aspect, [&](const auto& policy)
+        {
+            return MonitoredMaxProbability(settings, policy, targetError, progress);
+        });
+        std::cout << "---------------------- Maximum Probability " << result.maximumProbability << " +- " << result.standardError
+            << " Line Length: " << result.lineLength << " ----------------------" << std::endl;
+        std::cout << "Lengths stopped early: " << result.lengthsStoppedEarly << " of " << LENGTH_COUNT << " Total trials: "
+            << result.totalTrials << " (a full sweep would use " << LENGTH_COUNT * settings.trialsPerLength << ")" << std::endl;
+        return 0;
+    }
 
+    std::vector<unsigned long long> lengthCounts = settings.reuse != SampleReuse::None ? CountSweepWithCommonSamples(settings) :
+        WithLattice(lattice, aspect, [&](const auto& policy) { return CountSweep(settings, policy); });
+    SweepResult result = MaxProbabilityOfCrossingExactlyOneLine(settings, lengthCounts);
+    std::cout << "---------------------- Maximum Probability " << result.maximumProbability << " Line Length: " << result.lineLength << " ----------------------" << std::endl;
+    if (settings.replicates > 1)
+        std::cout << "Standard error at the maximum: " << result.standardError << std::endl;
+    if (lattice == LatticeKind::Square)
+        std::cout << "Quadrature probability at that length: " << QuadratureProbability(result.lineLength) << std::endl;
+}
\ No newline at end of file
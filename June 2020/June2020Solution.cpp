@@ -6,6 +6,13 @@
 #include <numeric>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <limits>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
 
 enum class RingStartAngle
 {
@@ -13,43 +20,224 @@ enum class RingStartAngle
     Angled = 1,   // 30 Percent
 };
 
+enum class Precision
+{
+    Double,
+    DoubleDouble,
+    Interval,
+};
+
+/*
+ * An unevaluated sum hi_ + lo_ of two doubles with |lo_| <= ulp(hi_) / 2, good
+ * for about 106 bits. The operations are the usual error-free transformations
+ * (Dekker, Knuth) with one renormalisation each.
+ */
+struct DoubleDouble
+{
+    double hi_, lo_;
+    DoubleDouble(double hi = 0, double lo = 0) : hi_(hi), lo_(lo) {};
+
+    static DoubleDouble QuickTwoSum(double a, double b)
+    {
+        double sum = a + b;
+        return { sum, b - (sum - a) };
+    }
+    static DoubleDouble TwoSum(double a, double b)
+    {
+        double sum = a + b;
+        double bPart = sum - a;
+        return { sum, (a - (sum - bPart)) + (b - bPart) };
+    }
+    static DoubleDouble TwoProduct(double a, double b)
+    {
+        double product = a * b;
+        return { product, std::fma(a, b, -product) };
+    }
+
+    DoubleDouble operator-() const { return { -hi_, -lo_ }; }
+    friend DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b)
+    {
+        DoubleDouble high = TwoSum(a.hi_, b.hi_);
+        DoubleDouble low = TwoSum(a.lo_, b.lo_);
+        high = QuickTwoSum(high.hi_, high.lo_ + low.hi_);
+        return QuickTwoSum(high.hi_, high.lo_ + low.lo_);
+    }
+    friend DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b) { return a + -b; }
+    friend DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b)
+    {
+        DoubleDouble product = TwoProduct(a.hi_, b.hi_);
+        return QuickTwoSum(product.hi_, product.lo_ + (a.hi_ * b.lo_ + a.lo_ * b.hi_));
+    }
+    friend DoubleDouble operator/(const DoubleDouble& a, const DoubleDouble& b)
+    {
+        double q1 = a.hi_ / b.hi_;
+        DoubleDouble remainder = a - b * q1;
+        double q2 = remainder.hi_ / b.hi_;
+        remainder = remainder - b * q2;
+        double q3 = remainder.hi_ / b.hi_;
+        return QuickTwoSum(q1, q2) + q3;
+    }
+    friend DoubleDouble sqrt(const DoubleDouble& a)
+    {
+        if (a.hi_ <= 0)
+            return std::sqrt(a.hi_);
+        // One Newton step from the double square root doubles its precision.
+        double root = std::sqrt(a.hi_);
+        return QuickTwoSum(root, (a - TwoProduct(root, root)).hi_ * 0.5 / root);
+    }
+
+    friend bool operator<(const DoubleDouble& a, const DoubleDouble& b) { return a.hi_ < b.hi_ || (a.hi_ == b.hi_ && a.lo_ < b.lo_); }
+    friend bool operator>(const DoubleDouble& a, const DoubleDouble& b) { return b < a; }
+    friend bool operator<=(const DoubleDouble& a, const DoubleDouble& b) { return !(b < a); }
+    friend bool operator>=(const DoubleDouble& a, const DoubleDouble& b) { return !(a < b); }
+
+    // Scientific notation with 32 significant digits, peeled off one at a time.
+    friend std::ostream& operator<<(std::ostream& out, DoubleDouble value)
+    {
+        if (value.hi_ < 0)
+        {
+            out << '-';
+            value = -value;
+        }
+        if (value.hi_ == 0 || !std::isfinite(value.hi_))
+            return out << value.hi_;
+        int exponent{};
+        for (; value.hi_ >= 10.; ++exponent)
+            value = value / 10.;
+        for (; value.hi_ < 1.; --exponent)
+            value = value * 10.;
+        std::string digits;
+        for (int i{}; i < 32; ++i)
+        {
+            double digit = std::floor(value.hi_);
+            if (digit == value.hi_ && value.lo_ < 0)
+                digit -= 1.;
+            digit = std::min(std::max(digit, 0.), 9.);
+            digits += (char)('0' + (int)digit);
+            value = (value - digit) * 10.;
+        }
+        return out << digits[0] << '.' << digits.substr(1) << 'e' << exponent;
+    }
+};
+
+/*
+ * A closed interval [lo_, hi_] that is guaranteed to contain the exact result.
+ * Round-to-nearest is off by at most half an ulp, so stepping every computed
+ * bound one ulp outwards encloses the true value without having to switch the
+ * rounding mode.
+ */
+struct Interval
+{
+    double lo_, hi_;
+    Interval(double value = 0) : lo_(value), hi_(value) {};
+    Interval(double lo, double hi) : lo_(lo), hi_(hi) {};
+
+    static double Down(double value) { return std::nextafter(value, -INFINITY); }
+    static double Up(double value) { return std::nextafter(value, INFINITY); }
+    static Interval Widened(double lo, double hi) { return { Down(lo), Up(hi) }; }
+
+    double Width() const { return hi_ - lo_; }
+
+    Interval operator-() const { return { -hi_, -lo_ }; }
+    friend Interval operator+(const Interval& a, const Interval& b) { return Widened(a.lo_ + b.lo_, a.hi_ + b.hi_); }
+    friend Interval operator-(const Interval& a, const Interval& b) { return Widened(a.lo_ - b.hi_, a.hi_ - b.lo_); }
+    friend Interval operator*(const Interval& a, const Interval& b)
+    {
+        double products[] = { a.lo_ * b.lo_, a.lo_ * b.hi_, a.hi_ * b.lo_, a.hi_ * b.hi_ };
+        return Widened(*std::min_element(std::begin(products), std::end(products)), *std::max_element(std::begin(products), std::end(products)));
+    }
+    friend Interval operator/(const Interval& a, const Interval& b)
+    {
+        // Dividing by an interval that holds zero could give anything.
+        if (b.lo_ <= 0 && b.hi_ >= 0)
+            return { -INFINITY, INFINITY };
+        return a * Widened(1. / b.hi_, 1. / b.lo_);
+    }
+    friend Interval sqrt(const Interval& a)
+    {
+        return { std::max(0., Down(std::sqrt(std::max(a.lo_, 0.)))), Up(std::sqrt(std::max(a.hi_, 0.))) };
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const Interval& value)
+    {
+        return out << "[" << value.lo_ << ", " << value.hi_ << "]";
+    }
+};
+
+template <typename Real>
+Real Pi() { return M_PI; }
+
+template <>
+DoubleDouble Pi<DoubleDouble>() { return { 3.141592653589793116e+00, 1.224646799147353207e-16 }; }
+
+// M_PI is the double just below pi.
+template <>
+Interval Pi<Interval>() { return { M_PI, Interval::Up(M_PI) }; }
+
+/*
+ * cos(multiple * 30 degrees), built from 0, 1/2 and sqrt(3)/2 so it is as
+ * exact as Real itself. Every circle of a ring sits at such an angle.
+ */
+template <typename Real>
+Real CosOfMultipleOf30Degrees(int multiple)
+{
+    using std::sqrt;
+    switch (((multiple % 12) + 12) % 12)
+    {
+    case 0: return Real(1);
+    case 1: case 11: return sqrt(Real(3)) / Real(2);
+    case 2: case 10: return Real(0.5);
+    case 3: case 9: return Real(0);
+    case 4: case 8: return Real(-0.5);
+    case 5: case 7: return -sqrt(Real(3)) / Real(2);
+    default: return Real(-1);
+    }
+}
+
+template <typename Real>
+Real SinOfMultipleOf30Degrees(int multiple)
+{
+    return CosOfMultipleOf30Degrees<Real>(multiple - 3);
+}
+
+template <typename Real>
 struct Point
 {
-    double x_, y_;
-    Point(double x, double y) : x_(x), y_(y) {};
+    Real x_, y_;
+    Point(Real x, Real y) : x_(x), y_(y) {};
     Point() : x_(0), y_(0) {};
 };
 
+template <typename Real>
 struct Circle
 {
-    double radius_;
-    Point center_;
+    Real radius_;
+    Point<Real> center_;
 
-    Circle(Point center = {}, double radius = 0) : center_(center), radius_(radius) {};
+    Circle(Point<Real> center = {}, Real radius = 0) : center_(center), radius_(radius) {};
 
-    double Area() const { return M_PI * std::pow(radius_, 2); };
-    double Perimeter() const { return M_PI * 2. * radius_; };
-    bool CrossesOtherCircle(const Circle& other) const
+    Real Area() const { return Pi<Real>() * radius_ * radius_; };
+    Real Perimeter() const { return Pi<Real>() * Real(2) * radius_; };
+    Real SquaredCenterDistance(const Circle& other) const
     {
-        double xDistance = std::pow((center_.x_ - other.center_.x_), 2);
-        double yDistance = std::pow((center_.y_ - other.center_.y_), 2);
-        double distanceBetweenCircles = std::sqrt(xDistance + yDistance);
-        if (distanceBetweenCircles < (radius_ + other.radius_))
-            return true;
-        return false;
+        Real xDistance = center_.x_ - other.center_.x_;
+        Real yDistance = center_.y_ - other.center_.y_;
+        return xDistance * xDistance + yDistance * yDistance;
     }
 };
 
-using Circles = std::vector<Circle>;
+template <typename Real>
+using Circles = std::vector<Circle<Real>>;
 
+template <typename Real>
 struct Ring
 {
-    double sideLength_;
+    Real sideLength_;
     RingStartAngle ringStartAngle_;
-    Point center_;
-    Circles circles_;
+    Point<Real> center_;
+    Circles<Real> circles_;
 
-    Ring(Point center, double sideLength, RingStartAngle ringStartAngle) : 
+    Ring(Point<Real> center, Real sideLength, RingStartAngle ringStartAngle) : 
         center_(center), sideLength_(sideLength), ringStartAngle_(ringStartAngle)
     {
         // Create Ring
@@ -82,52 +270,72 @@ struct Ring
         circles_.clear();
         for (int i{}; i < 6; ++i)
         {
-            double radius = sideLength_ / 2.;
-            double xPoint = sideLength_ * std::cos(i * M_PI / 3. + ((int)ringStartAngle_ * M_PI / 6.));
-            double yPoint = sideLength_ * std::sin(i * M_PI / 3. + ((int)ringStartAngle_ * M_PI / 6.));
-            circles_.emplace_back(Circle({ xPoint, yPoint }, radius ));
+            // In steps of 30 degrees: 60 per circle plus the ring's 0 or 30.
+            int angle = 2 * i + (int)ringStartAngle_;
+            Real radius = sideLength_ / Real(2);
+            Real xPoint = sideLength_ * CosOfMultipleOf30Degrees<Real>(angle);
+            Real yPoint = sideLength_ * SinOfMultipleOf30Degrees<Real>(angle);
+            circles_.emplace_back(Circle<Real>({ xPoint, yPoint }, radius ));
         }
     }
 
-    double OccupyingArea() const
+    Real OccupyingArea() const
     {
-        return circles_[0].Area() * 6.;
+        return circles_[0].Area() * Real(6);
     }
 
-    bool RingFitsSnuglyAboveAnotherRing(const Ring& other)
+    /*
+     * Smallest gap between a circle of this ring and one of the other ring;
+     * negative when they overlap. Each ring's circles share one radius, so the
+     * closest pair is found on squared centre distances and only it takes a
+     * square root.
+     */
+    Real MinimumGap(const Ring& other) const
     {
-        for (int i{}; i < circles_.size(); ++i)
-        {
-            for (int j{}; j < other.circles_.size(); ++j)
-            {
-                // No circle ever crosses another, and the circles don't touch anymore.
-                if (circles_[i].CrossesOtherCircle(other.circles_[j]))
-                {
-                    return false;
-                }    
-            }
-        }
-        return true;
+        using std::sqrt;
+        Real minimumSquaredDistance = INFINITY;
+        for (const Circle<Real>& circle : circles_)
+            for (const Circle<Real>& otherCircle : other.circles_)
+                minimumSquaredDistance = std::min(minimumSquaredDistance, circle.SquaredCenterDistance(otherCircle));
+        return sqrt(minimumSquaredDistance) - (circles_[0].radius_ + other.circles_[0].radius_);
     }
 
-    void DecrementSideLength(double increment)
+    Real Perimeter() const
     {
-        sideLength_ -= increment;
-        CreateRings();
+        return Real(2) * Pi<Real>() * sideLength_ * Real(1.5);
     }
+};
 
-    double Perimeter() const
+
+/*
+ * The largest ring inside the previous one, at the given angle, that does not
+ * overlap it. Shrinking the new ring only opens the gap between the two, so
+ * the gap changes sign once between 0 and the previous side length and
+ * bisection on it converges. It stops once the bracket is down to neighbouring
+ * doubles, after about 60 evaluations, and the result is the side length at
+ * which the rings touch to full double precision.
+ */
+Ring<double> ContactRing(const Ring<double>& previousRing, RingStartAngle ringStartAngle)
+{
+    double fits{}, overlaps = previousRing.sideLength_;
+    while (true)
     {
-        return 2 * M_PI * sideLength_ * 1.5;
+        double middle = fits + (overlaps - fits) / 2.;
+        if (middle <= fits || middle >= overlaps)
+            break;
+        if (Ring<double>({}, middle, ringStartAngle).MinimumGap(previousRing) >= 0)
+            fits = middle;
+        else
+            overlaps = middle;
     }
-};
-
+    return Ring<double>({}, fits, ringStartAngle);
+}
 
-double WorkInwardsSolution()
+double WorkInwardsBySimulation()
 {
     double CRadius = 1.5, totalArea{};
     int initialStartAngle{};
-    Ring previousRing{ {}, 1, (RingStartAngle)initialStartAngle };
+    Ring<double> previousRing{ {}, 1, (RingStartAngle)initialStartAngle };
     while (true)
     {
         double addingArea = previousRing.OccupyingArea();
@@ -135,23 +343,357 @@ double WorkInwardsSolution()
             break;
         totalArea += addingArea;
         initialStartAngle++;
-        Ring newRing{ {}, previousRing.sideLength_ - 0.0000001, (RingStartAngle)(initialStartAngle % 2) };
-        while (!newRing.RingFitsSnuglyAboveAnotherRing(previousRing))
-        {
-            newRing.DecrementSideLength(0.0000001);
-        }
+        Ring<double> newRing = ContactRing(previousRing, (RingStartAngle)(initialStartAngle % 2));
         std::cout << "Found the next hexagon's best-fit radius: " << newRing.sideLength_ << ". Are we angled? " << (int)newRing.ringStartAngle_ << std::endl;
         previousRing = newRing;
     }
     return totalArea / (M_PI * CRadius * CRadius);
 }
 
-int main()
+/*
+ * Neighbouring rings are turned 30 degrees against each other, so every circle
+ * of the new ring sits in the notch between two circles of the old one and, by
+ * symmetry, all twelve contacts happen at once. A ring of side L has circles of
+ * radius L / 2 at distance L from the centre, so by the law of cosines the new
+ * ring touches when
+ *
+ *   L^2 + L'^2 - 2 L L' cos(30) = (L + L')^2 / 4,
+ *
+ * that is 3 r^2 - (4 sqrt(3) + 2) r + 3 = 0 for r = L' / L. The roots multiply
+ * to 1, so the smaller one (the ring inside) is computed as the reciprocal of
+ * the larger to avoid cancellation.
+ */
+template <typename Real>
+Real RingScaleFactor()
+{
+    using std::sqrt;
+    Real b = Real(4) * sqrt(Real(3)) + Real(2);
+    return Real(6) / (b + sqrt(b * b - Real(36)));
+}
+
+template <typename Real>
+Ring<Real> NextRing(const Ring<Real>& previousRing)
+{
+    RingStartAngle nextAngle = previousRing.ringStartAngle_ == RingStartAngle::Standard ? RingStartAngle::Angled : RingStartAngle::Standard;
+    return Ring<Real>({}, previousRing.sideLength_ * RingScaleFactor<Real>(), nextAngle);
+}
+
+/*
+ * Every ring is the previous one scaled by r, so the areas form a geometric
+ * series with ratio r^2. With Real = Interval the result is an enclosure of
+ * the exact proportion.
+ */
+template <typename Real>
+Real WorkInwardsSolution()
+{
+    Real CRadius = 1.5;
+    Ring<Real> firstRing{ {}, Real(1), RingStartAngle::Standard };
+    Real scale = RingScaleFactor<Real>();
+    Real totalArea = firstRing.OccupyingArea() / (Real(1) - scale * scale);
+    return totalArea / (Pi<Real>() * CRadius * CRadius);
+}
+
+template <typename Real>
+void PrintSolution(Real solution)
+{
+    std::cout.precision(17);
+    std::cout << "Area proportion: " << solution << std::endl;
+}
+
+template <>
+void PrintSolution<Interval>(Interval solution)
+{
+    std::cout.precision(17);
+    std::cout << "Area proportion: " << solution << std::endl;
+    std::cout << "Enclosure width: " << solution.Width() << std::endl;
+}
+
+template <typename Real>
+void SolveAndPrint()
 {
     std::chrono::time_point<std::chrono::system_clock> t1 = std::chrono::system_clock::now();
-    auto solutionTuple = WorkInwardsSolution();
+    Real solution = WorkInwardsSolution<Real>();
     std::chrono::time_point<std::chrono::system_clock> t2 = std::chrono::system_clock::now();
     std::cout << "The efficient solution takes (in microseconds): " << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << std::endl;
-    std::cout << "Area proportion: " << solutionTuple << std::endl;
+    PrintSolution(solution);
+}
+
+/*
+ * The general puzzle: k circles per ring, each touching its two neighbours, so
+ * a ring of side L has circles of radius sin(pi / k) L. Ring i is turned by
+ * phases_[i % phases_.size()] of the angle between neighbouring circles. The
+ * first ring touches the container of radius containerRadius_, as in the
+ * original puzzle (k = 6, phases {0, 0.5}, container 1.5 around side 1), so
+ * the container radius sets the scale of the packing but not the fraction.
+ */
+struct PackingParameters
+{
+    int circlesPerRing_ = 6;
+    double containerRadius_ = 1.5;
+    std::vector<double> phases_ = { 0., 0.5 };
+
+    double Spacing() const { return 2. * M_PI / circlesPerRing_; }
+    double RadiusRatio() const { return std::sin(M_PI / circlesPerRing_); }
+    double Phase(size_t ring) const { return phases_[ring % phases_.size()] * Spacing(); }
+    double FirstSideLength() const { return containerRadius_ / (1. + RadiusRatio()); }
+    bool IsValid() const { return circlesPerRing_ >= 3 && containerRadius_ > 0 && !phases_.empty(); }
+};
+
+struct KFoldRing
+{
+    int circlesPerRing_;
+    double sideLength_, phase_;
+    std::vector<Circle<double>> circles_;
+
+    KFoldRing(int circlesPerRing, double sideLength, double phase) :
+        circlesPerRing_(circlesPerRing), sideLength_(sideLength), phase_(phase)
+    {
+        double radius = sideLength_ * std::sin(M_PI / circlesPerRing_);
+        for (int i{}; i < circlesPerRing_; ++i)
+        {
+            double angle = phase_ + i * 2. * M_PI / circlesPerRing_;
+            circles_.emplace_back(Circle<double>({ sideLength_ * std::cos(angle), sideLength_ * std::sin(angle) }, radius));
+        }
+    }
+
+    /*
+     * Smallest gap to a ring with the same number of circles. Only the two
+     * circles of the other ring on either side of each circle's angle can be
+     * the closest, so this is 2k comparisons instead of k^2. As in
+     * Ring::MinimumGap they compare squared distances.
+     */
+    double MinimumGap(const KFoldRing& other) const
+    {
+        double spacing = 2. * M_PI / circlesPerRing_, minimumSquaredDistance = INFINITY;
+        for (int i{}; i < circlesPerRing_; ++i)
+        {
+            double steps = std::floor((phase_ - other.phase_) / spacing) + i;
+            int below = (int)(((long long)steps % circlesPerRing_ + circlesPerRing_) % circlesPerRing_);
+            int above = (below + 1) % circlesPerRing_;
+            minimumSquaredDistance = std::min({ minimumSquaredDistance, circles_[i].SquaredCenterDistance(other.circles_[below]),
+                circles_[i].SquaredCenterDistance(other.circles_[above]) });
+        }
+        return std::sqrt(minimumSquaredDistance) - (circles_[0].radius_ + other.circles_[0].radius_);
+    }
+};
+
+/*
+ * RingScaleFactor for k circles, with the new ring's circles turned by offset
+ * against the nearest circle of the old one. The law of cosines with circle
+ * radius rho L gives (1 - rho^2) r^2 - 2 (cos(offset) + rho^2) r + (1 - rho^2) = 0.
+ */
+double KFoldScaleFactor(const PackingParameters& packing, size_t ring)
+{
+    double turn = std::fmod(packing.Phase(ring + 1) - packing.Phase(ring), packing.Spacing());
+    if (turn < 0)
+        turn += packing.Spacing();
+    double offset = std::min(turn, packing.Spacing() - turn);
+    double rhoSquared = packing.RadiusRatio() * packing.RadiusRatio();
+    double b = std::cos(offset) + rhoSquared, c = 1. - rhoSquared;
+    return c / (b + std::sqrt(std::max(b * b - c * c, 0.)));
+}
+
+/*
+ * The rings scale by a factor that repeats with the phase pattern, so the
+ * areas over one pattern period are summed directly and the periods form a
+ * geometric series. NaN for fewer than three circles per ring.
+ */
+double PackedFraction(const PackingParameters& packing)
+{
+    if (!packing.IsValid())
+        return NAN;
+    double circleRadius = packing.RadiusRatio() * packing.FirstSideLength();
+    double ringArea = packing.circlesPerRing_ * M_PI * circleRadius * circleRadius;
+    double periodArea{}, areaScale = 1.;
+    for (size_t ring{}; ring < packing.phases_.size(); ++ring)
+    {
+        periodArea += ringArea * areaScale;
+        double scale = KFoldScaleFactor(packing, ring);
+        areaScale *= scale * scale;
+    }
+    double totalArea = periodArea / (1. - areaScale);
+    return totalArea / (M_PI * packing.containerRadius_ * packing.containerRadius_);
+}
+
+// Gap between the first two rings relative to the second's side; zero up to rounding when they touch.
+double FirstContactGap(const PackingParameters& packing)
+{
+    KFoldRing outer(packing.circlesPerRing_, packing.FirstSideLength(), packing.Phase(0));
+    KFoldRing inner(packing.circlesPerRing_, packing.FirstSideLength() * KFoldScaleFactor(packing, 0), packing.Phase(1));
+    return inner.MinimumGap(outer) / inner.sideLength_;
+}
+
+// Runs body(i) for every i in [0, count), spread over one thread per core.
+void ParallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+    const unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    for (unsigned t{0}; t < threadCount; ++t)
+    {
+        workers.emplace_back([&]()
+        {
+            for (size_t i = next++; i < count; i = next++)
+                body(i);
+        });
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+struct SweepGrid
+{
+    double first, last;
+    int steps;
 
+    double At(int step) const { return steps > 1 ? first + (last - first) * step / (steps - 1) : first; }
+};
+
+/*
+ * Packs every combination of circles per ring and phase offset, where the
+ * offset is the turn of every second ring as a fraction of the angle between
+ * neighbouring circles. The container radius only rescales the packing, so it
+ * is not swept. Configurations are spread over the thread pool and written to
+ * the CSV in grid order.
+ */
+int SweepToCsv(int firstCircles, int lastCircles, SweepGrid offsets, const std::string& path)
+{
+    std::ofstream output(path);
+    if (!output.is_open())
+    {
+        std::cout << "Could not open " << path << std::endl;
+        return 1;
+    }
+    output << "circles_per_ring,phase_offset,packed_fraction,contact_gap\n";
+
+    const size_t circleCount = std::max(0, lastCircles - std::max(firstCircles, 3) + 1);
+    const size_t offsetCount = std::max(0, offsets.steps);
+    std::vector<std::string> lines(circleCount * offsetCount);
+    ParallelFor(lines.size(), [&](size_t job)
+    {
+        PackingParameters packing;
+        packing.circlesPerRing_ = std::max(firstCircles, 3) + (int)(job / offsetCount);
+        packing.phases_ = { 0., offsets.At((int)(job % offsetCount)) };
+
+        std::ostringstream line;
+        line.precision(17);
+        line << packing.circlesPerRing_ << ',' << packing.phases_[1] << ','
+            << PackedFraction(packing) << ',' << FirstContactGap(packing) << '\n';
+        lines[job] = line.str();
+    });
+    for (const std::string& line : lines)
+        output << line;
+    return 0;
+}
+
+std::vector<double> ParsePhases(const std::string& list)
+{
+    std::vector<double> phases;
+    std::stringstream stream(list);
+    for (std::string phase; std::getline(stream, phase, ',');)
+        phases.push_back(std::stod(phase));
+    return phases;
+}
+
+/*
+ * June2020Solution [--simulate] [--precision double|double-double|interval]
+ *
+ * --simulate builds the rings one by one, solving each contact numerically,
+ * in double precision. --precision picks the arithmetic for the closed form:
+ * double-double gives about 32 digits and interval a certified enclosure.
+ *
+ * June2020Solution [--circles <k>] [--container <radius>] [--phases <p0,p1,...>]
+ *
+ * Packs k circles per ring with the given phase pattern, in fractions of the
+ * angle between neighbouring circles, into a container of the given radius.
+ *
+ * June2020Solution --sweep <first k> <last k> <offset steps> <csv>
+ *
+ * Runs PackedFraction over the grid, with phase offsets from 0 to 0.5.
+ * Rings of fewer than 3 circles are skipped.
+ */
+int main(int argc, char* argv[])
+{
+    bool simulate{}, general{};
+    PackingParameters packing;
+    Precision precision = Precision::Double;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        if (argument == "--simulate")
+            simulate = true;
+        else if (argument == "--circles" && i + 1 < argc)
+        {
+            packing.circlesPerRing_ = std::stoi(argv[++i]);
+            general = true;
+        }
+        else if (argument == "--container" && i + 1 < argc)
+        {
+            packing.containerRadius_ = std::stod(argv[++i]);
+            general = true;
+        }
+        else if (argument == "--phases" && i + 1 < argc)
+        {
+            packing.phases_ = ParsePhases(argv[++i]);
+            general = true;
+        }
+        else if (argument == "--sweep" && i + 4 < argc)
+        {
+            return SweepToCsv(std::stoi(argv[i + 1]), std::stoi(argv[i + 2]), { 0., 0.5, std::stoi(argv[i + 3]) }, argv[i + 4]);
+        }
+        else if (argument == "--precision" && i + 1 < argc)
+        {
+            std::string name = argv[++i];
+            if (name == "double")
+                precision = Precision::Double;
+            else if (name == "double-double")
+                precision = Precision::DoubleDouble;
+            else if (name == "interval")
+                precision = Precision::Interval;
+            else
+            {
+                std::cerr << "Unknown precision: " << name << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown or incomplete argument: " << argument << "\n"
+                << "Usage: " << argv[0] << " [--simulate] [--precision double|double-double|interval]\n"
+                << "       " << argv[0] << " [--circles <k>] [--container <radius>] [--phases <p0,p1,...>]\n"
+                << "       " << argv[0] << " --sweep <first k> <last k> <offset steps> <csv>" << std::endl;
+            return 1;
+        }
+    }
+
+    if (general)
+    {
+        if (!packing.IsValid())
+        {
+            std::cerr << "Packing needs at least 3 circles per ring, a positive container radius and at least one phase" << std::endl;
+            return 1;
+        }
+        std::cout.precision(17);
+        std::cout << "First ring side length: " << packing.FirstSideLength() << std::endl;
+        std::cout << "Packed fraction: " << PackedFraction(packing) << std::endl;
+        std::cout << "Contact gap: " << FirstContactGap(packing) << std::endl;
+        return 0;
+    }
+
+    if (simulate)
+    {
+        std::chrono::time_point<std::chrono::system_clock> t1 = std::chrono::system_clock::now();
+        auto solutionTuple = WorkInwardsBySimulation();
+        std::chrono::time_point<std::chrono::system_clock> t2 = std::chrono::system_clock::now();
+        std::cout << "The efficient solution takes (in microseconds): " << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << std::endl;
+        PrintSolution(solutionTuple);
+        return 0;
+    }
+
+    switch (precision)
+    {
+    case Precision::Double: SolveAndPrint<double>(); break;
+    case Precision::DoubleDouble: SolveAndPrint<DoubleDouble>(); break;
+    case Precision::Interval: SolveAndPrint<Interval>(); break;
+    }
 }
@@ -1,12 +1,49 @@
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <mutex>
 #include <numeric>
+#include <string>
+#include <thread>
 #include <tuple>
 /*
  COMPILE WITH C++17
 */
 
+namespace
+{
+    // The first row holds 1 to INITIAL_ROW_SIZE. Before each rearrangement the
+    // next VALUES_ADDED_PER_ROW values are appended to the end of the row.
+    const int INITIAL_ROW_SIZE = 25;
+    const int VALUES_ADDED_PER_ROW = 3;
+    const long long TARGET_VALUE = 11;
+
+    // A pattern in the shaded values counts once it has held for this many
+    // periods and at least MIN_CONFIRMED_ROWS rows at the end of the record.
+    const long long MAX_DETECTED_PERIOD = 4096;
+    const long long CONFIRMATION_PERIODS = 8;
+    const long long MIN_CONFIRMED_ROWS = 512;
+}
+
+// The puzzle as posed uses the constants above; all of them can be changed at run time.
+struct PuzzleParameters
+{
+    long long initialRowSize = INITIAL_ROW_SIZE;
+    long long valuesAddedPerRow = VALUES_ADDED_PER_ROW;
+    long long target = TARGET_VALUE;
+
+    // Number of values in row r, counting from 1.
+    long long RowSize(long long row) const { return initialRowSize + (valuesAddedPerRow - 1) * (row - 1); }
+
+    // With fewer than two values added per row the shaded column eventually runs off the end.
+    bool HasShadedCell(long long row) const { return row - 1 < RowSize(row); }
+
+    long long FirstValueAddedAfter(long long row) const { return initialRowSize + valuesAddedPerRow * (row - 1) + 1; }
+};
+
 template <class T>
 void Print(const std::vector<T>& obj)
 {
@@ -15,52 +52,533 @@ void Print(const std::vector<T>& obj)
     std::cout << std::endl;
 }
 
-void RearrangeRow(std::vector<int>& singleRow, int shadedLocation)
+/*
+ * Reordering a row nearest-first around the shaded location (ties go left) and
+ * dropping the shaded value is a fixed index map. The first 2 * min(left, right)
+ * slots alternate between the left and right neighbours, then the rest of the
+ * longer side follows, moving away from the shaded location. Returns the index in
+ * the old row of the value that ends up at destination in the new one.
+ */
+inline long long NearestFirstSource(long long destination, long long shadedLocation, long long rowSize)
 {
-    std::vector<std::tuple<int, int, int>> relativePositions;
-    relativePositions.reserve(singleRow.size());
-    for (int i{0}; i < singleRow.size(); ++i)
-        relativePositions.push_back(std::tuple(i, std::abs(shadedLocation - i), singleRow[i]));
+    long long left = shadedLocation, right = rowSize - 1 - shadedLocation;
+    long long paired = std::min(left, right);
+    if (destination < 2 * paired)
+        return destination % 2 == 0 ? shadedLocation - 1 - destination / 2 : shadedLocation + 1 + destination / 2;
+    long long distance = destination - paired;
+    return left > right ? shadedLocation - 1 - distance : shadedLocation + 1 + distance;
+}
 
-    std::sort(relativePositions.begin(), relativePositions.end(), 
-        [](const std::tuple<int, int, int>& A, const std::tuple<int, int, int>& B)
-        {
-            return std::abs(std::get<1>(A)) < std::abs(std::get<1>(B)) || (std::abs(std::get<1>(A)) == std::abs(std::get<1>(B)) &&
-             std::get<0>(A) < std::get<0>(B)); 
-        });
-    std::cout << std::endl;
-    std::vector<int> newVec;
-    for (int i{1}; i < relativePositions.size(); ++i)
-        newVec.push_back(std::get<2>(relativePositions[i]));
-    singleRow = newVec;
+// The inverse map: where the value at source in the old row ends up in the new one.
+inline long long NearestFirstDestination(long long source, long long shadedLocation, long long rowSize)
+{
+    long long left = shadedLocation, right = rowSize - 1 - shadedLocation;
+    long long paired = std::min(left, right), distance = std::abs(source - shadedLocation);
+    if (distance <= paired)
+        return 2 * (distance - 1) + (source > shadedLocation ? 1 : 0);
+    return paired + distance - 1;
 }
 
-int Solution()
+/*
+ * Keeps the row in one of two buffers. A step appends the new values in place,
+ * then writes the rearranged row straight into the other buffer, reading
+ * outwards from the shaded location and writing front to back, and swaps the
+ * two. The buffers only grow, by doubling, when a row no longer fits, so steps
+ * do not allocate. Values are ints, as in the original row, to halve the memory
+ * traffic; they stay below 2^31 for the first 700 million rows.
+ */
+class PingPongRows
+{
+public:
+    PingPongRows(const PuzzleParameters& puzzle, long long capacity)
+        : current_(std::max(capacity, puzzle.initialRowSize)), next_(current_.size()), size_(puzzle.initialRowSize),
+        valuesAddedPerRow_(puzzle.valuesAddedPerRow), nextValue_(static_cast<int>(puzzle.initialRowSize) + 1)
+    {
+        std::iota(current_.begin(), current_.begin() + size_, 1);
+    }
+
+    long long Size() const { return size_; }
+    int operator[](long long column) const { return current_[column]; }
+
+    void Step(long long shadedLocation)
+    {
+        if (size_ + valuesAddedPerRow_ > static_cast<long long>(current_.size()))
+        {
+            current_.resize(2 * (size_ + valuesAddedPerRow_));
+            next_.resize(current_.size());
+        }
+        const int* row = current_.data();
+        // The new values continue the count. With fewer than three added per row
+        // the last value of the row is not always the largest so far.
+        for (int added{0}; added < valuesAddedPerRow_; ++added)
+            current_[size_ + added] = nextValue_++;
+        long long rowSize = size_ + valuesAddedPerRow_;
+
+        int* out = next_.data();
+        long long left = shadedLocation, right = rowSize - 1 - shadedLocation, paired = std::min(left, right);
+        for (long long distance{1}; distance <= paired; ++distance)
+        {
+            *out++ = row[shadedLocation - distance];
+            *out++ = row[shadedLocation + distance];
+        }
+        if (left > right)
+            for (long long distance{paired + 1}; distance <= left; ++distance)
+                *out++ = row[shadedLocation - distance];
+        else
+            out = std::copy(row + shadedLocation + paired + 1, row + rowSize, out);
+
+        size_ = rowSize - 1;
+        current_.swap(next_);
+    }
+
+private:
+    std::vector<int> current_, next_;
+    long long size_, valuesAddedPerRow_;
+    int nextValue_;
+};
+
+// Returns 0 if the shaded column runs off the end of the row first.
+int SolutionBySimulation(const PuzzleParameters& puzzle)
 {
-    int result{}, shadedLocation{};
     int rowCount{0};
-    std::vector<int> row = std::vector<int>(25, 0);
-    std::iota(row.begin(), row.end(), 1);
+    PingPongRows row(puzzle, 2 * puzzle.RowSize(1024));
     while (true)
     {
         ++rowCount;
+        long long shadedLocation = rowCount - 1;
+        if (!puzzle.HasShadedCell(rowCount))
+            return 0;
         std::cout << "Shaded location at column: " << shadedLocation << " row: " << rowCount << ", corresponds to: " << row[shadedLocation] << std::endl;
-        if (11 == row[shadedLocation]) 
+        if (puzzle.target == row[shadedLocation]) 
         {
-            Print(row);
+            for (long long column{0}; column < row.Size(); ++column)
+                std::cout << row[column] << ' ';
+            std::cout << std::endl;
             break;
         }
-        row.insert(row.end(), {row.back() + 1, row.back() + 2, row.back() + 3});
-        RearrangeRow(row, shadedLocation);
-        ++shadedLocation;
+        row.Step(shadedLocation);
     }
     return rowCount;
 }
 
-int main()
+/*
+ * Row r (from 1) has initialRowSize + (valuesAddedPerRow - 1)(r - 1) values and is
+ * shaded at column r - 1. Going from row k to row k + 1 appends the next values, which
+ * are the only ones that are new, then applies NearestFirstSource. So the value at
+ * (row, column) is found by pulling the column back through those maps one row at a
+ * time, until it lands either on an appended value or in the first row. That takes
+ * O(row) steps and no row storage at all.
+ */
+long long ValueAt(const PuzzleParameters& puzzle, long long row, long long column)
 {
-    int solution = Solution();
+    for (long long previous{row - 1}; previous >= 1; --previous)
+    {
+        long long previousSize = puzzle.RowSize(previous);
+        long long source = NearestFirstSource(column, previous - 1, previousSize + puzzle.valuesAddedPerRow);
+        if (source >= previousSize)
+            return puzzle.FirstValueAddedAfter(previous) + (source - previousSize);
+        column = source;
+    }
+    return column + 1;
+}
+
+// Returns 0 if the shaded column runs off the end of the row first.
+int Solution(const PuzzleParameters& puzzle)
+{
+    long long rowCount{0};
+    while (true)
+    {
+        ++rowCount;
+        if (!puzzle.HasShadedCell(rowCount))
+            return 0;
+        long long shadedLocation = rowCount - 1, shadedValue = ValueAt(puzzle, rowCount, shadedLocation);
+        std::cout << "Shaded location at column: " << shadedLocation << " row: " << rowCount << ", corresponds to: " << shadedValue << std::endl;
+        if (puzzle.target == shadedValue)
+        {
+            for (long long column{0}; column < puzzle.RowSize(rowCount); ++column)
+                std::cout << ValueAt(puzzle, rowCount, column) << ' ';
+            std::cout << std::endl;
+            break;
+        }
+    }
+    return rowCount;
+}
+
+/*
+ * Answers many targets in one pass. A value leaves the row once it is shaded,
+ * so each is shaded at most once. Rather than rerunning the search for every
+ * target, the positions of the targets are tracked forwards through
+ * NearestFirstDestination, from the row where each first appears, and the row at
+ * which each reaches the shaded column is recorded. Returns 0 for targets not
+ * shaded within maxRows rows.
+ */
+std::vector<long long> FirstShadedRows(const PuzzleParameters& puzzle, const std::vector<long long>& targets, long long maxRows)
+{
+    std::vector<size_t> order(targets.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return targets[a] < targets[b]; });
+
+    std::vector<long long> shadedRows(targets.size(), 0);
+    std::vector<std::pair<long long, size_t>> pending; // (position, target index) of targets in the current row
+    size_t nextTarget{0};
+    auto admit = [&](long long lastValue, long long firstPosition, long long firstValue)
+    {
+        for (; nextTarget < order.size() && targets[order[nextTarget]] <= lastValue; ++nextTarget)
+            if (targets[order[nextTarget]] >= firstValue)
+                pending.emplace_back(firstPosition + targets[order[nextTarget]] - firstValue, order[nextTarget]);
+    };
+    admit(puzzle.initialRowSize, 0, 1);
+
+    for (long long row{1}; row <= maxRows && puzzle.HasShadedCell(row) && (!pending.empty() || nextTarget < order.size()); ++row)
+    {
+        long long shadedLocation = row - 1, size = puzzle.RowSize(row);
+        for (size_t i{0}; i < pending.size(); ++i)
+        {
+            if (pending[i].first == shadedLocation)
+            {
+                shadedRows[pending[i].second] = row;
+                pending[i] = pending.back();
+                pending.pop_back();
+                break;
+            }
+        }
+
+        long long firstAdded = puzzle.FirstValueAddedAfter(row);
+        admit(firstAdded + puzzle.valuesAddedPerRow - 1, size, firstAdded);
+        for (std::pair<long long, size_t>& target : pending)
+            target.first = NearestFirstDestination(target.first, shadedLocation, size + puzzle.valuesAddedPerRow);
+    }
+    return shadedRows;
+}
+
+/*
+ * Analysis of the sequence of shaded values, for targets the search may never
+ * reach. The sequence is recorded for up to maxRows rows, 4 bytes a row and no
+ * logging. Then two things can settle a target:
+ *
+ *  - The shaded column ran off the end of the row (fewer than two values added
+ *    per row). The record is then complete and a target missing from it is
+ *    never shaded.
+ *  - The tail of the record is arithmetic with some period P: a[n + P] - a[n]
+ *    depends only on n mod P. Found with a difference table at lag P for each
+ *    P in turn, accepting the first that holds over the required number of
+ *    rows. Targets are then placed by solving for the step in their residue,
+ *    or ruled out when no residue's progression contains them.
+ *
+ * The second verdict is an extrapolation: it holds if the pattern does. With
+ * one or two values added per row, elements that leave the neighbourhood of
+ * the shaded column never come back and the pattern settles quickly. With
+ * three or more, an element's offset from the shaded column roughly follows the
+ * tent map x -> 2|1 - x| and no pattern is expected. The record then simply
+ * ends at maxRows without a verdict, instead of searching forever.
+ */
+struct ShadedPattern
+{
+    bool found;
+    long long start;               // Index from which the pattern holds
+    long long period;
+    std::vector<long long> drift;  // a[n + period] - a[n], by n % period
+};
+
+enum class Verdict
+{
+    Shaded,         // Seen in the record
+    Extrapolated,   // Found by extending the pattern
+    Never,          // The record is complete and does not contain it
+    NeverByPattern, // No residue of the pattern reaches it
+    Undecided,      // Not in the record and no pattern found
+};
+
+std::vector<int> ShadedValues(const PuzzleParameters& puzzle, long long maxRows, bool& complete)
+{
+    std::vector<int> shaded;
+    PingPongRows row(puzzle, 2 * puzzle.RowSize(std::min(maxRows, 1ll << 16)));
+    complete = false;
+    for (long long rowCount{1}; rowCount <= maxRows; ++rowCount)
+    {
+        if (!puzzle.HasShadedCell(rowCount))
+        {
+            complete = true;
+            break;
+        }
+        shaded.push_back(row[rowCount - 1]);
+        row.Step(rowCount - 1);
+    }
+    return shaded;
+}
+
+ShadedPattern DetectPattern(const std::vector<int>& shaded)
+{
+    const long long count = shaded.size();
+    for (long long period{1}; period <= MAX_DETECTED_PERIOD && CONFIRMATION_PERIODS * period <= count; ++period)
+    {
+        std::vector<long long> drift(period);
+        for (long long n{count - 2 * period}; n < count - period; ++n)
+            drift[n % period] = static_cast<long long>(shaded[n + period]) - shaded[n];
+        long long start{count - 2 * period};
+        while (start > 0 && static_cast<long long>(shaded[start - 1 + period]) - shaded[start - 1] == drift[(start - 1) % period])
+            --start;
+        if (count - start >= std::max(CONFIRMATION_PERIODS * period, MIN_CONFIRMED_ROWS))
+            return {true, start, period, drift};
+    }
+    return {false, 0, 0, {}};
+}
+
+// Returns the verdict and, when the target is shaded, its row.
+std::pair<Verdict, long long> AnalyzeTarget(const std::vector<int>& shaded, bool complete, const ShadedPattern& pattern, long long target)
+{
+    for (size_t n{0}; n < shaded.size(); ++n)
+        if (shaded[n] == target)
+            return {Verdict::Shaded, n + 1};
+    if (complete)
+        return {Verdict::Never, 0};
+    if (!pattern.found)
+        return {Verdict::Undecided, 0};
+
+    // Extend each residue from its last recorded value.
+    const long long count = shaded.size();
+    long long bestRow{0};
+    for (long long last{count - pattern.period}; last < count; ++last)
+    {
+        long long drift = pattern.drift[last % pattern.period], gap = target - shaded[last];
+        if (drift == 0 || gap % drift != 0 || gap / drift < 1)
+            continue;
+        long long row = last + gap / drift * pattern.period + 1;
+        if (bestRow == 0 || row < bestRow)
+            bestRow = row;
+    }
+    return bestRow ? std::make_pair(Verdict::Extrapolated, bestRow) : std::make_pair(Verdict::NeverByPattern, 0ll);
+}
+
+// Runs body(i) for every i in [0, count), spread over one thread per core.
+void ParallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+    const unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    for (unsigned t{0}; t < threadCount; ++t)
+    {
+        workers.emplace_back([&]()
+        {
+            for (size_t i = next++; i < count; i = next++)
+                body(i);
+        });
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+struct SweepRange
+{
+    long long first, last;
+};
+
+/*
+ * Solves every combination of initial row size, values added per row and target
+ * in the given ranges. Each (row size, values added) pair is one independent job
+ * on the thread pool that answers all its targets with one FirstShadedRows pass.
+ * Finished jobs are written to the CSV in grid order as soon as every job before
+ * them is done. A row count of 0 means the target was not shaded within maxRows.
+ */
+int SweepToCsv(SweepRange rowSizes, SweepRange valuesAdded, SweepRange targets, long long maxRows, const std::string& path)
+{
+    std::ofstream output(path);
+    if (!output.is_open())
+    {
+        std::cout << "Could not open " << path << std::endl;
+        return 1;
+    }
+    output << "initial_row_size,values_added_per_row,target,rows\n";
+
+    const long long rowSizeCount = std::max(0ll, rowSizes.last - rowSizes.first + 1);
+    const long long jobCount = rowSizeCount * std::max(0ll, valuesAdded.last - valuesAdded.first + 1);
+    std::vector<long long> targetValues;
+    for (long long target{targets.first}; target <= targets.last; ++target)
+        targetValues.push_back(target);
+
+    std::vector<std::string> finished(jobCount);
+    std::vector<char> done(jobCount, 0);
+    long long nextToWrite{0};
+    std::mutex outputMutex;
+    ParallelFor(jobCount, [&](size_t job)
+    {
+        PuzzleParameters puzzle;
+        puzzle.initialRowSize = rowSizes.first + job % rowSizeCount;
+        puzzle.valuesAddedPerRow = valuesAdded.first + job / rowSizeCount;
+        std::vector<long long> rows = FirstShadedRows(puzzle, targetValues, maxRows);
+
+        std::string lines;
+        for (size_t i{0}; i < targetValues.size(); ++i)
+            lines += std::to_string(puzzle.initialRowSize) + ',' + std::to_string(puzzle.valuesAddedPerRow) + ',' +
+                std::to_string(targetValues[i]) + ',' + std::to_string(rows[i]) + '\n';
+
+        std::lock_guard<std::mutex> lock(outputMutex);
+        finished[job] = std::move(lines);
+        done[job] = 1;
+        for (; nextToWrite < jobCount && done[nextToWrite]; ++nextToWrite)
+        {
+            output << finished[nextToWrite];
+            finished[nextToWrite].clear();
+        }
+        output.flush();
+    });
+    return 0;
+}
+
+void PrintUsage()
+{
+    std::cout << "Usage: Solution [--initial <row size>] [--added <values per row>] [--target <value>]\n"
+        << "                [--simulate] [--value-at <row> <column>]\n"
+        << "                [--targets <first value> <last value> <max rows>]\n"
+        << "                [--sweep <first size> <last size> <first added> <last added>\n"
+        << "                         <first target> <last target> <max rows> <csv file>]\n"
+        << "                [--analyze <max rows>]" << std::endl;
+}
+
+/*
+ * Solution [--initial <row size>] [--added <values per row>] [--target <value>]
+ *          [--simulate] [--value-at <row> <column>]
+ *          [--targets <first value> <last value> <max rows>]
+ *          [--sweep <first size> <last size> <first added> <last added>
+ *                   <first target> <last target> <max rows> <csv file>]
+ *          [--analyze <max rows>]
+ *
+ * --simulate keeps the whole row in memory and rearranges it every step.
+ * --value-at prints the value at one cell of any row without simulating.
+ * --targets prints the row at which each value in the range is shaded, or 0 if
+ * that does not happen within max rows.
+ * --sweep solves every combination in the ranges in parallel and writes a CSV.
+ * --analyze looks for a pattern in the first max rows of shaded values and
+ * uses it to place the target or rule it out.
+ */
+int main(int argc, char* argv[])
+{
+    PuzzleParameters puzzle;
+    std::vector<std::string> arguments(argv + 1, argv + argc);
+    std::string mode;
+    std::vector<std::string> modeArguments;
+    for (size_t i{0}; i < arguments.size(); ++i)
+    {
+        const std::string& option = arguments[i];
+        bool isMode = option == "--simulate" || option == "--value-at" || option == "--targets" || option == "--sweep" ||
+            option == "--analyze";
+        if (!isMode && option != "--initial" && option != "--added" && option != "--target")
+        {
+            std::cout << "Unknown argument: " << option << std::endl;
+            PrintUsage();
+            return 1;
+        }
+        size_t valueCount = option == "--value-at" ? 2 : option == "--targets" ? 3 : option == "--sweep" ? 8 :
+            option == "--analyze" ? 1 :
+            option == "--simulate" ? 0 : 1;
+        if (i + valueCount >= arguments.size() && valueCount > 0)
+        {
+            std::cout << option << " needs " << valueCount << " values" << std::endl;
+            return 1;
+        }
+        if (option == "--initial")
+            puzzle.initialRowSize = std::stoll(arguments[i + 1]);
+        else if (option == "--added")
+            puzzle.valuesAddedPerRow = std::stoll(arguments[i + 1]);
+        else if (option == "--target")
+            puzzle.target = std::stoll(arguments[i + 1]);
+        else
+        {
+            mode = option;
+            modeArguments.assign(arguments.begin() + i + 1, arguments.begin() + i + 1 + valueCount);
+        }
+        i += valueCount;
+    }
+    if (puzzle.initialRowSize < 1 || puzzle.valuesAddedPerRow < 1)
+    {
+        std::cout << "The first row needs at least one value and at least one value must be added per row" << std::endl;
+        return 1;
+    }
+
+    if (mode == "--value-at")
+    {
+        long long row = std::stoll(modeArguments[0]), column = std::stoll(modeArguments[1]);
+        if (row < 1 || column < 0 || column >= puzzle.RowSize(row))
+        {
+            std::cout << "Row " << row << " has columns 0 to " << puzzle.RowSize(std::max(row, 1ll)) - 1 << std::endl;
+            return 1;
+        }
+        std::cout << "Row " << row << " column " << column << ": " << ValueAt(puzzle, row, column) << std::endl;
+        return 0;
+    }
+
+    if (mode == "--targets")
+    {
+        long long first = std::stoll(modeArguments[0]), last = std::stoll(modeArguments[1]), maxRows = std::stoll(modeArguments[2]);
+        std::vector<long long> targets;
+        for (long long value{first}; value <= last; ++value)
+            targets.push_back(value);
+        std::vector<long long> shadedRows = FirstShadedRows(puzzle, targets, maxRows);
+        long long found{0};
+        for (size_t i{0}; i < targets.size(); ++i)
+        {
+            std::cout << targets[i] << ' ' << shadedRows[i] << '\n';
+            found += shadedRows[i] != 0;
+        }
+        std::cout << "Shaded within " << maxRows << " rows: " << found << " of " << targets.size() << std::endl;
+        return 0;
+    }
+
+    if (mode == "--sweep")
+    {
+        std::vector<long long> bounds;
+        for (int i{0}; i < 7; ++i)
+            bounds.push_back(std::stoll(modeArguments[i]));
+        if (bounds[0] < 1 || bounds[2] < 1)
+        {
+            std::cout << "Row sizes and values added per row start at 1" << std::endl;
+            return 1;
+        }
+        return SweepToCsv({bounds[0], bounds[1]}, {bounds[2], bounds[3]}, {bounds[4], bounds[5]}, bounds[6], modeArguments[7]);
+    }
+
+    if (mode == "--analyze")
+    {
+        bool complete{};
+        std::vector<int> shaded = ShadedValues(puzzle, std::stoll(modeArguments[0]), complete);
+        ShadedPattern pattern = DetectPattern(shaded);
+        std::cout << "Recorded " << shaded.size() << " rows" << (complete ? ", the shaded column then runs off the row" : "") << std::endl;
+        if (pattern.found)
+        {
+            std::cout << "From row " << pattern.start + 1 << " every " << pattern.period << " rows the shaded value moves by";
+            for (long long drift : pattern.drift)
+                std::cout << ' ' << drift;
+            std::cout << std::endl;
+        }
+        else
+            std::cout << "No pattern with period up to " << MAX_DETECTED_PERIOD << std::endl;
+
+        std::pair<Verdict, long long> verdict = AnalyzeTarget(shaded, complete, pattern, puzzle.target);
+        switch (verdict.first)
+        {
+        case Verdict::Shaded:
+            std::cout << "Answer: " << verdict.second << std::endl;
+            break;
+        case Verdict::Extrapolated:
+            std::cout << "Answer: " << verdict.second << " (extrapolated from the pattern)" << std::endl;
+            break;
+        case Verdict::Never:
+            std::cout << puzzle.target << " is never shaded" << std::endl;
+            break;
+        case Verdict::NeverByPattern:
+            std::cout << puzzle.target << " is never shaded if the pattern continues" << std::endl;
+            break;
+        default:
+            std::cout << puzzle.target << " is not shaded in the first " << shaded.size() << " rows" << std::endl;
+        }
+        return 0;
+    }
+
+    int solution = mode == "--simulate" ? SolutionBySimulation(puzzle) : Solution(puzzle);
     std::cout << std::endl;
-    std::cout << "Answer: " << solution << std::endl;
+    if (solution == 0)
+        std::cout << "The shaded column runs off the end of the row before " << puzzle.target << " is shaded" << std::endl;
+    else
+        std::cout << "Answer: " << solution << std::endl;
     return 0;
 }
\ No newline at end of file